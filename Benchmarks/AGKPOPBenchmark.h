@@ -0,0 +1,62 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef AGKPOPBenchmark_h
+#define AGKPOPBenchmark_h
+
+#include <stdio.h>
+#include <time.h>
+
+// Keeps the compiler from dropping work whose result is otherwise unused
+static volatile double AGKPOPBenchmarkSink;
+
+static double AGKPOPBenchmarkNow(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+// Best of a few runs in seconds, so a context switch during one run doesn't count
+static double AGKPOPBenchmarkMeasure(void *context, void (*run)(void *context))
+{
+    double best = 1e300;
+    for(int i = 0; i < 5; i++)
+    {
+        double start = AGKPOPBenchmarkNow();
+        run(context);
+        double elapsed = AGKPOPBenchmarkNow() - start;
+        if(elapsed < best)
+        {
+            best = elapsed;
+        }
+    }
+    return best;
+}
+
+static void AGKPOPBenchmarkReport(const char *name, double operations, double seconds)
+{
+    printf("%-32s %10.2f M/s %10.3f ms\n", name, operations / seconds * 1e-6, seconds * 1e3);
+}
+
+#endif
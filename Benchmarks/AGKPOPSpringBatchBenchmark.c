@@ -0,0 +1,135 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// AGKPOPSpringBatchAdvance, which runs two components per instruction with
+// SSE2 or NEON, against stepping every component with AGKPOPSpringStepApply.
+
+#include "AGKPOPBenchmark.h"
+#include "AGKPOPSpring.h"
+#include "AGKPOPSpringBatch.h"
+#include <stdlib.h>
+
+// 1000 quadrilaterals for ten seconds at 60 fps
+static const size_t kAGKPOPSpringBatchBenchmarkSprings = 1000;
+static const size_t kAGKPOPSpringBatchBenchmarkDimension = 8;
+static const int kAGKPOPSpringBatchBenchmarkFrames = 600;
+static const double kAGKPOPSpringBatchBenchmarkFrameDuration = 1.0 / 60.0;
+
+typedef struct AGKPOPSpringBatchBenchmarkState {
+    AGKPOPSpringBatch *batch;
+    AGKPOPSpringBatchHandle *handles;
+    double *p;
+    double *v;
+} AGKPOPSpringBatchBenchmarkState;
+
+static void AGKPOPSpringBatchBenchmarkReset(double *p, double *v, size_t spring)
+{
+    for(size_t i = 0; i < kAGKPOPSpringBatchBenchmarkDimension; i++)
+    {
+        p[i] = (double)(spring * kAGKPOPSpringBatchBenchmarkDimension + i);
+        v[i] = 0.0;
+    }
+}
+
+static void AGKPOPSpringBatchBenchmarkBatched(void *context)
+{
+    AGKPOPSpringBatchBenchmarkState *state = context;
+    for(size_t spring = 0; spring < kAGKPOPSpringBatchBenchmarkSprings; spring++)
+    {
+        AGKPOPSpringBatchBenchmarkReset(AGKPOPSpringBatchPositions(state->batch, state->handles[spring]),
+                                        AGKPOPSpringBatchVelocities(state->batch, state->handles[spring]), spring);
+    }
+    for(int frame = 0; frame < kAGKPOPSpringBatchBenchmarkFrames; frame++)
+    {
+        AGKPOPSpringBatchAdvance(state->batch, kAGKPOPSpringBatchBenchmarkFrameDuration);
+    }
+    AGKPOPBenchmarkSink = AGKPOPSpringBatchPositions(state->batch, state->handles[kAGKPOPSpringBatchBenchmarkSprings - 1])[0];
+}
+
+// What every spring did on its own before the batch: one step per spring, applied per component
+static void AGKPOPSpringBatchBenchmarkScalar(void *context)
+{
+    AGKPOPSpringBatchBenchmarkState *state = context;
+    size_t dimension = kAGKPOPSpringBatchBenchmarkDimension;
+    for(size_t spring = 0; spring < kAGKPOPSpringBatchBenchmarkSprings; spring++)
+    {
+        AGKPOPSpringBatchBenchmarkReset(state->p + spring * dimension, state->v + spring * dimension, spring);
+    }
+    AGKPOPSpringStep step = AGKPOPSpringStepMake(300.0, 10.0, 1.0, kAGKPOPSpringBatchBenchmarkFrameDuration);
+    for(int frame = 0; frame < kAGKPOPSpringBatchBenchmarkFrames; frame++)
+    {
+        for(size_t i = 0; i < kAGKPOPSpringBatchBenchmarkSprings * dimension; i++)
+        {
+            AGKPOPSpringStepApply(step, &state->p[i], &state->v[i]);
+        }
+    }
+    AGKPOPBenchmarkSink = state->p[(kAGKPOPSpringBatchBenchmarkSprings - 1) * dimension];
+}
+
+int main(void)
+{
+    AGKPOPSpringBatchBenchmarkState state;
+    size_t lanes = kAGKPOPSpringBatchBenchmarkSprings * kAGKPOPSpringBatchBenchmarkDimension;
+    state.batch = AGKPOPSpringBatchCreate(kAGKPOPSpringBatchBenchmarkDimension);
+    state.handles = malloc(kAGKPOPSpringBatchBenchmarkSprings * sizeof(AGKPOPSpringBatchHandle));
+    state.p = malloc(lanes * sizeof(double));
+    state.v = malloc(lanes * sizeof(double));
+    if(!state.batch || !state.handles || !state.p || !state.v)
+    {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    for(size_t spring = 0; spring < kAGKPOPSpringBatchBenchmarkSprings; spring++)
+    {
+        state.handles[spring] = AGKPOPSpringBatchAdd(state.batch, 300.0, 10.0, 1.0);
+        if(state.handles[spring] == kAGKPOPSpringBatchInvalidHandle)
+        {
+            fprintf(stderr, "Out of memory\n");
+            return 1;
+        }
+    }
+
+#if defined(__SSE2__)
+    const char *kernel = "SSE2";
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const char *kernel = "NEON";
+#else
+    const char *kernel = "no SIMD";
+#endif
+
+    double frames = (double)lanes * kAGKPOPSpringBatchBenchmarkFrames;
+    double batched = AGKPOPBenchmarkMeasure(&state, AGKPOPSpringBatchBenchmarkBatched);
+    double scalar = AGKPOPBenchmarkMeasure(&state, AGKPOPSpringBatchBenchmarkScalar);
+
+    printf("%zu springs of %zu components, %d frames, %s (component frames per second)\n",
+           kAGKPOPSpringBatchBenchmarkSprings, kAGKPOPSpringBatchBenchmarkDimension, kAGKPOPSpringBatchBenchmarkFrames, kernel);
+    AGKPOPBenchmarkReport("AGKPOPSpringBatchAdvance", frames, batched);
+    AGKPOPBenchmarkReport("AGKPOPSpringStepApply", frames, scalar);
+    printf("batch is %.1fx faster\n", scalar / batched);
+
+    AGKPOPSpringBatchDestroy(state.batch);
+    free(state.handles);
+    free(state.p);
+    free(state.v);
+    return 0;
+}
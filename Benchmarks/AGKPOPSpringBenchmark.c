@@ -0,0 +1,124 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Closed form spring step against POP's RK4 integration, see the XCTest
+// performance tests in AGKPOPSpringTests.m for the same comparison on device.
+
+#include "AGKPOPBenchmark.h"
+#include "AGKPOPSpring.h"
+#include <math.h>
+#include <stdlib.h>
+
+// 1000 coordinates for ten seconds at 60 fps
+static const int kAGKPOPSpringBenchmarkCount = 1000;
+static const int kAGKPOPSpringBenchmarkFrames = 600;
+static const double kAGKPOPSpringBenchmarkFrameDuration = 1.0 / 60.0;
+
+typedef struct AGKPOPSpringBenchmarkState {
+    double *p;
+    double *v;
+} AGKPOPSpringBenchmarkState;
+
+static void AGKPOPSpringBenchmarkReset(AGKPOPSpringBenchmarkState *state)
+{
+    for(int i = 0; i < kAGKPOPSpringBenchmarkCount; i++)
+    {
+        state->p[i] = i;
+        state->v[i] = 0.0;
+    }
+}
+
+// POP integrates the spring with RK4 in steps of 1 ms, see POPSpringSolver.h
+static void AGKPOPSpringBenchmarkRK4(double k, double b, double m, double *p, double *v, double t)
+{
+    const double dt = 0.001;
+    long steps = lround(t / dt);
+    for(long i = 0; i < steps; i++)
+    {
+        double ap = *v;
+        double av = (-k * *p - b * *v) / m;
+        double bp = *v + av * dt / 2.0;
+        double bv = (-k * (*p + ap * dt / 2.0) - b * (*v + av * dt / 2.0)) / m;
+        double cp = *v + bv * dt / 2.0;
+        double cv = (-k * (*p + bp * dt / 2.0) - b * (*v + bv * dt / 2.0)) / m;
+        double dp = *v + cv * dt;
+        double dv = (-k * (*p + cp * dt) - b * (*v + cv * dt)) / m;
+        *p += (ap + 2.0 * bp + 2.0 * cp + dp) / 6.0 * dt;
+        *v += (av + 2.0 * bv + 2.0 * cv + dv) / 6.0 * dt;
+    }
+}
+
+static void AGKPOPSpringBenchmarkClosedForm(void *context)
+{
+    AGKPOPSpringBenchmarkState *state = context;
+    AGKPOPSpringBenchmarkReset(state);
+    AGKPOPSpringStep step = AGKPOPSpringStepMake(300.0, 10.0, 1.0, kAGKPOPSpringBenchmarkFrameDuration);
+    for(int frame = 0; frame < kAGKPOPSpringBenchmarkFrames; frame++)
+    {
+        for(int i = 0; i < kAGKPOPSpringBenchmarkCount; i++)
+        {
+            AGKPOPSpringStepApply(step, &state->p[i], &state->v[i]);
+        }
+    }
+    AGKPOPBenchmarkSink = state->p[kAGKPOPSpringBenchmarkCount - 1];
+}
+
+static void AGKPOPSpringBenchmarkIntegrated(void *context)
+{
+    AGKPOPSpringBenchmarkState *state = context;
+    AGKPOPSpringBenchmarkReset(state);
+    for(int frame = 0; frame < kAGKPOPSpringBenchmarkFrames; frame++)
+    {
+        for(int i = 0; i < kAGKPOPSpringBenchmarkCount; i++)
+        {
+            AGKPOPSpringBenchmarkRK4(300.0, 10.0, 1.0, &state->p[i], &state->v[i], kAGKPOPSpringBenchmarkFrameDuration);
+        }
+    }
+    AGKPOPBenchmarkSink = state->p[kAGKPOPSpringBenchmarkCount - 1];
+}
+
+int main(void)
+{
+    AGKPOPSpringBenchmarkState state;
+    state.p = malloc(kAGKPOPSpringBenchmarkCount * sizeof(double));
+    state.v = malloc(kAGKPOPSpringBenchmarkCount * sizeof(double));
+    if(!state.p || !state.v)
+    {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    double frames = (double)kAGKPOPSpringBenchmarkCount * kAGKPOPSpringBenchmarkFrames;
+    double closedForm = AGKPOPBenchmarkMeasure(&state, AGKPOPSpringBenchmarkClosedForm);
+    double integrated = AGKPOPBenchmarkMeasure(&state, AGKPOPSpringBenchmarkIntegrated);
+
+    printf("%d coordinates, %d frames of %.1f ms (coordinate frames per second)\n",
+           kAGKPOPSpringBenchmarkCount, kAGKPOPSpringBenchmarkFrames, kAGKPOPSpringBenchmarkFrameDuration * 1e3);
+    AGKPOPBenchmarkReport("closed form", frames, closedForm);
+    AGKPOPBenchmarkReport("RK4, 1 ms steps", frames, integrated);
+    printf("closed form is %.1fx faster\n", integrated / closedForm);
+
+    free(state.p);
+    free(state.v);
+    return 0;
+}
@@ -0,0 +1,138 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <XCTest/XCTest.h>
+#import "AGKPOPBufferPool.h"
+
+@interface AGKPOPBufferPoolTests : XCTestCase
+
+@end
+
+@implementation AGKPOPBufferPoolTests
+
+- (void)testSizesAreRoundedUpToBuckets
+{
+    AGKPOPBufferPool *pool = AGKPOPBufferPoolCreate(1024 * 1024);
+
+    // Four buckets per power of two, nothing below 4 KB
+    const size_t sizes[][2] = {{1, 4096}, {4096, 4096}, {4097, 5120}, {6144, 6144}, {7000, 7168}, {8193, 10240}, {100000, 114688}};
+    for(size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        void *buffer = AGKPOPBufferPoolAcquire(pool, sizes[i][0]);
+        XCTAssertTrue(buffer != NULL);
+        memset(buffer, 0xAB, sizes[i][0]);
+        AGKPOPBufferPoolRelease(pool, buffer);
+        XCTAssertEqual(AGKPOPBufferPoolGetStatistics(pool).cachedBytes, sizes[i][1]);
+        AGKPOPBufferPoolPurge(pool);
+    }
+
+    AGKPOPBufferPoolDestroy(pool);
+}
+
+- (void)testReleasedBuffersAreReused
+{
+    AGKPOPBufferPool *pool = AGKPOPBufferPoolCreate(1024 * 1024);
+
+    void *first = AGKPOPBufferPoolAcquire(pool, 5000);
+    AGKPOPBufferPoolRelease(pool, first);
+    void *second = AGKPOPBufferPoolAcquire(pool, 4500);
+    void *third = AGKPOPBufferPoolAcquire(pool, 4500);
+
+    // 5000 and 4500 both round up to 5120
+    XCTAssertTrue(second == first);
+    XCTAssertTrue(third != first);
+    AGKPOPBufferPoolStatistics statistics = AGKPOPBufferPoolGetStatistics(pool);
+    XCTAssertEqual(statistics.hits, (size_t)1);
+    XCTAssertEqual(statistics.misses, (size_t)2);
+    XCTAssertEqual(statistics.cachedBytes, (size_t)0);
+
+    AGKPOPBufferPoolRelease(pool, second);
+    AGKPOPBufferPoolRelease(pool, third);
+    AGKPOPBufferPoolResetStatistics(pool);
+    statistics = AGKPOPBufferPoolGetStatistics(pool);
+    XCTAssertEqual(statistics.hits + statistics.misses + statistics.discards, (size_t)0);
+    XCTAssertEqual(statistics.cachedBytes, (size_t)10240);
+
+    AGKPOPBufferPoolDestroy(pool);
+}
+
+- (void)testReleasesBeyondTheCapAreDiscarded
+{
+    AGKPOPBufferPool *pool = AGKPOPBufferPoolCreate(3 * 8192);
+
+    void *buffers[5];
+    for(int i = 0; i < 5; i++)
+    {
+        buffers[i] = AGKPOPBufferPoolAcquire(pool, 8192);
+    }
+    for(int i = 0; i < 5; i++)
+    {
+        AGKPOPBufferPoolRelease(pool, buffers[i]);
+    }
+
+    AGKPOPBufferPoolStatistics statistics = AGKPOPBufferPoolGetStatistics(pool);
+    XCTAssertEqual(statistics.cachedBytes, (size_t)(3 * 8192));
+    XCTAssertEqual(statistics.discards, (size_t)2);
+    XCTAssertEqual(statistics.maxCachedBytes, (size_t)(3 * 8192));
+
+    AGKPOPBufferPoolDestroy(pool);
+}
+
+- (void)testLoweringTheCapEvictsLargestFirst
+{
+    AGKPOPBufferPool *pool = AGKPOPBufferPoolCreate(1024 * 1024);
+
+    void *small = AGKPOPBufferPoolAcquire(pool, 4096);
+    void *medium = AGKPOPBufferPoolAcquire(pool, 16384);
+    void *large = AGKPOPBufferPoolAcquire(pool, 65536);
+    AGKPOPBufferPoolRelease(pool, small);
+    AGKPOPBufferPoolRelease(pool, medium);
+    AGKPOPBufferPoolRelease(pool, large);
+    XCTAssertEqual(AGKPOPBufferPoolGetStatistics(pool).cachedBytes, (size_t)(4096 + 16384 + 65536));
+
+    // Only the large buffer has to go to get below the cap
+    AGKPOPBufferPoolSetMaxCachedBytes(pool, 65536);
+    XCTAssertEqual(AGKPOPBufferPoolGetStatistics(pool).cachedBytes, (size_t)(4096 + 16384));
+    AGKPOPBufferPoolResetStatistics(pool);
+    AGKPOPBufferPoolRelease(pool, AGKPOPBufferPoolAcquire(pool, 4096));
+    AGKPOPBufferPoolRelease(pool, AGKPOPBufferPoolAcquire(pool, 16384));
+    AGKPOPBufferPoolRelease(pool, AGKPOPBufferPoolAcquire(pool, 65536));
+    AGKPOPBufferPoolStatistics statistics = AGKPOPBufferPoolGetStatistics(pool);
+    XCTAssertEqual(statistics.hits, (size_t)2);
+    XCTAssertEqual(statistics.misses, (size_t)1);
+
+    AGKPOPBufferPoolPurge(pool);
+    XCTAssertEqual(AGKPOPBufferPoolGetStatistics(pool).cachedBytes, (size_t)0);
+
+    AGKPOPBufferPoolDestroy(pool);
+}
+
+- (void)testWorksWithoutAPool
+{
+    void *buffer = AGKPOPBufferPoolAcquire(NULL, 10000);
+    XCTAssertTrue(buffer != NULL);
+    memset(buffer, 0xAB, 10000);
+    AGKPOPBufferPoolRelease(NULL, buffer);
+}
+
+@end
@@ -0,0 +1,133 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <XCTest/XCTest.h>
+#import "AGKPOPDecay.h"
+
+static double AGKPOPDecayTestsUniform(uint32_t *state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return (*state >> 8) / (double)(1u << 24);
+}
+
+// decay_position in POPDecayAnimationInternal.h stepped 1 ms at a time until POP
+// would stop, every component of the velocity below 5 * threshold. Returns the
+// number of steps.
+static long AGKPOPDecayTestsStep(double *p, double *v, size_t count, double deceleration, double threshold)
+{
+    long steps = 0;
+    for(;;)
+    {
+        bool moving = false;
+        for(size_t i = 0; i < count; i++)
+        {
+            moving = moving || fabs(v[i]) >= 5.0 * threshold;
+        }
+        if(!moving)
+        {
+            return steps;
+        }
+        for(size_t i = 0; i < count; i++)
+        {
+            p[i] += v[i] / 1000.0 * deceleration;
+            v[i] *= deceleration;
+        }
+        steps++;
+    }
+}
+
+@interface AGKPOPDecayTests : XCTestCase
+
+@end
+
+@implementation AGKPOPDecayTests
+
+- (void)testMatchesSteppingPOP
+{
+    const double decelerations[] = {0.998, 0.99, 0.95};
+    const double threshold = 0.01;
+    uint32_t seed = 1;
+    for(int i = 0; i < 300; i++)
+    {
+        double deceleration = decelerations[i % 3];
+        double from[4], velocity[4], p[4], v[4], to[4];
+        for(size_t j = 0; j < 4; j++)
+        {
+            from[j] = p[j] = (AGKPOPDecayTestsUniform(&seed) - 0.5) * 1000.0;
+            velocity[j] = v[j] = (AGKPOPDecayTestsUniform(&seed) - 0.5) * 4000.0;
+        }
+
+        long steps = AGKPOPDecayTestsStep(p, v, 4, deceleration, threshold);
+        double duration = AGKPOPDecayProjectedValue(from, velocity, 4, deceleration, threshold, to);
+
+        // Stepping stops at the first whole millisecond after the closed form
+        XCTAssertEqual(steps, (long)ceil(duration * 1000.0 - 1e-9));
+        for(size_t j = 0; j < 4; j++)
+        {
+            // At most part of the last step apart, which moves less than 5 * threshold / 1000
+            XCTAssertEqualWithAccuracy(to[j], p[j], 5.0 * threshold / 1000.0 + 1e-9);
+        }
+
+        // And at the whole millisecond both agree up to rounding
+        double q[4], w[4];
+        AGKPOPDecayEvaluate(from, velocity, 4, deceleration, steps / 1000.0, q, w);
+        for(size_t j = 0; j < 4; j++)
+        {
+            XCTAssertEqualWithAccuracy(q[j], p[j], 1e-9);
+            XCTAssertEqualWithAccuracy(w[j], v[j], 1e-9);
+        }
+    }
+}
+
+- (void)testStoppedVelocityHasNoDuration
+{
+    const double from[2] = {10.0, 20.0};
+    const double velocity[2] = {0.04, -0.04};
+    double to[2];
+    XCTAssertEqual(AGKPOPDecayProjectedValue(from, velocity, 2, 0.998, 0.01, to), 0.0);
+    XCTAssertEqual(to[0], 10.0);
+    XCTAssertEqual(to[1], 20.0);
+}
+
+- (void)testDecelerationOfOneOrMoreNeverStops
+{
+    const double from[3] = {10.0, 20.0, 30.0};
+    const double velocity[3] = {100.0, -100.0, 0.0};
+    const double decelerations[] = {1.0, 1.001};
+    for(int i = 0; i < 2; i++)
+    {
+        XCTAssertEqual(AGKPOPDecayDuration(velocity, 3, decelerations[i], 0.01), INFINITY);
+
+        double to[3];
+        XCTAssertEqual(AGKPOPDecayProjectedValue(from, velocity, 3, decelerations[i], 0.01, to), INFINITY);
+        XCTAssertEqual(to[0], INFINITY);
+        XCTAssertEqual(to[1], -INFINITY);
+        XCTAssertEqual(to[2], 30.0);
+    }
+
+    // Unless it is already slow enough to stop
+    const double slow[1] = {0.01};
+    XCTAssertEqual(AGKPOPDecayDuration(slow, 1, 1.0, 0.01), 0.0);
+}
+
+@end
@@ -0,0 +1,233 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <XCTest/XCTest.h>
+#import "AGKPOPHomography.h"
+#import "CATransform3D+AGKPOPHomography.h"
+
+static double AGKPOPHomographyTestsUniform(uint32_t *state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return (*state >> 8) / (double)(1u << 24);
+}
+
+static void AGKPOPHomographyTestsProject(const double h[9], double x, double y, double *outX, double *outY)
+{
+    double w = h[6] * x + h[7] * y + h[8];
+    *outX = (h[0] * x + h[1] * y + h[2]) / w;
+    *outY = (h[3] * x + h[4] * y + h[5]) / w;
+}
+
+static CGPoint AGKPOPHomographyTestsApplyTransform(CATransform3D t, CGFloat x, CGFloat y)
+{
+    CGFloat w = t.m14 * x + t.m24 * y + t.m44;
+    return CGPointMake((t.m11 * x + t.m21 * y + t.m41) / w, (t.m12 * x + t.m22 * y + t.m42) / w);
+}
+
+// Largest distance between where h maps the corners of from and the corners of to
+static double AGKPOPHomographyTestsCornerError(const double h[9], const double from[8], const double to[8])
+{
+    double error = 0.0;
+    for(int corner = 0; corner < 4; corner++)
+    {
+        double x, y;
+        AGKPOPHomographyTestsProject(h, from[2 * corner], from[2 * corner + 1], &x, &y);
+        error = fmax(error, fmax(fabs(x - to[2 * corner]), fabs(y - to[2 * corner + 1])));
+    }
+    return error;
+}
+
+// A convex quad around a 200 x 150 rect at (x, y), corners moved up to 40 points
+static void AGKPOPHomographyTestsRandomQuad(uint32_t *seed, double x, double y, double quad[8])
+{
+    const double rect[8] = {x, y, x + 200.0, y, x + 200.0, y + 150.0, x, y + 150.0};
+    for(int i = 0; i < 8; i++)
+    {
+        quad[i] = rect[i] + (AGKPOPHomographyTestsUniform(seed) - 0.5) * 80.0;
+    }
+}
+
+@interface AGKPOPHomographyTests : XCTestCase
+
+@end
+
+@implementation AGKPOPHomographyTests
+
+- (void)testRectToQuadMapsCorners
+{
+    uint32_t seed = 1;
+    for(int i = 0; i < 1000; i++)
+    {
+        double x = AGKPOPHomographyTestsUniform(&seed) * 100.0 - 50.0;
+        double y = AGKPOPHomographyTestsUniform(&seed) * 100.0 - 50.0;
+        const double rect[8] = {x, y, x + 320.0, y, x + 320.0, y + 240.0, x, y + 240.0};
+        double quad[8];
+        AGKPOPHomographyTestsRandomQuad(&seed, 0.0, 0.0, quad);
+
+        double h[9];
+        XCTAssertTrue(AGKPOPHomographyRectToQuad(x, y, 320.0, 240.0, quad, h));
+        XCTAssertEqual(h[8], 1.0);
+        XCTAssertLessThan(AGKPOPHomographyTestsCornerError(h, rect, quad), 1e-9);
+    }
+}
+
+- (void)testQuadToQuadMapsCorners
+{
+    uint32_t seed = 2;
+    for(int i = 0; i < 1000; i++)
+    {
+        double from[8], to[8];
+        AGKPOPHomographyTestsRandomQuad(&seed, -20.0, 10.0, from);
+        AGKPOPHomographyTestsRandomQuad(&seed, 30.0, -40.0, to);
+
+        double h[9];
+        XCTAssertTrue(AGKPOPHomographyQuadToQuad(from, to, h));
+        XCTAssertLessThan(AGKPOPHomographyTestsCornerError(h, from, to), 1e-9);
+    }
+}
+
+- (void)testQuadToQuadTransformMapsCorners
+{
+    uint32_t seed = 4;
+    for(int i = 0; i < 100; i++)
+    {
+        double from[8], to[8];
+        AGKPOPHomographyTestsRandomQuad(&seed, -20.0, 10.0, from);
+        AGKPOPHomographyTestsRandomQuad(&seed, 30.0, -40.0, to);
+        AGKQuad source = AGKQuadMake(CGPointMake(from[0], from[1]), CGPointMake(from[2], from[3]),
+                                     CGPointMake(from[4], from[5]), CGPointMake(from[6], from[7]));
+        AGKQuad destination = AGKQuadMake(CGPointMake(to[0], to[1]), CGPointMake(to[2], to[3]),
+                                          CGPointMake(to[4], to[5]), CGPointMake(to[6], to[7]));
+
+        CATransform3D t = CATransform3DWithAGKQuadFromQuad_AGKPOP(source, destination);
+        for(int corner = 0; corner < 4; corner++)
+        {
+            CGPoint p = AGKPOPHomographyTestsApplyTransform(t, from[2 * corner], from[2 * corner + 1]);
+            XCTAssertEqualWithAccuracy(p.x, to[2 * corner], 1e-6);
+            XCTAssertEqualWithAccuracy(p.y, to[2 * corner + 1], 1e-6);
+        }
+    }
+}
+
+- (void)testDegenerateQuadToQuadTransformIsIdentity
+{
+    AGKQuad source = AGKQuadMake(CGPointMake(0.0, 0.0), CGPointMake(10.0, 0.0),
+                                 CGPointMake(20.0, 0.0), CGPointMake(30.0, 0.0));
+    AGKQuad destination = AGKQuadMakeWithCGRect(CGRectMake(0.0, 0.0, 100.0, 100.0));
+    XCTAssertTrue(CATransform3DIsIdentity(CATransform3DWithAGKQuadFromQuad_AGKPOP(source, destination)));
+}
+
+- (void)testRectToQuadMatchesAGGeometryKit
+{
+    uint32_t seed = 3;
+    CGRect rect = CGRectMake(10.0, 20.0, 200.0, 150.0);
+    for(int i = 0; i < 100; i++)
+    {
+        double quad[8];
+        AGKPOPHomographyTestsRandomQuad(&seed, 10.0, 20.0, quad);
+        AGKQuad q = AGKQuadMake(CGPointMake(quad[0], quad[1]), CGPointMake(quad[2], quad[3]),
+                                CGPointMake(quad[4], quad[5]), CGPointMake(quad[6], quad[7]));
+
+        CATransform3D expected = CATransform3DWithAGKQuadFromRect(q, rect);
+        CATransform3D actual = CATransform3DWithAGKQuadFromRect_AGKPOP(q, rect);
+
+        // Corners, edge midpoints and center of the rect
+        for(int j = 0; j < 9; j++)
+        {
+            CGFloat x = rect.origin.x + rect.size.width * (j % 3) / 2.0;
+            CGFloat y = rect.origin.y + rect.size.height * (j / 3) / 2.0;
+            CGPoint e = AGKPOPHomographyTestsApplyTransform(expected, x, y);
+            CGPoint a = AGKPOPHomographyTestsApplyTransform(actual, x, y);
+            XCTAssertEqualWithAccuracy(a.x, e.x, 1e-3);
+            XCTAssertEqualWithAccuracy(a.y, e.y, 1e-3);
+        }
+    }
+}
+
+- (void)testMovingCornersMatchesFullSolve
+{
+    uint32_t seed = 4;
+    const double rect[8] = {0.0, 0.0, 200.0, 0.0, 200.0, 150.0, 0.0, 150.0};
+    double quad[8];
+    AGKPOPHomographyTestsRandomQuad(&seed, 0.0, 0.0, quad);
+
+    AGKPOPHomographyState state;
+    XCTAssertTrue(AGKPOPHomographyStateInit(&state, 0.0, 0.0, 200.0, 150.0, quad));
+
+    // Drag corners around, one or two at a time like the coalescer does
+    for(int i = 0; i < 10000; i++)
+    {
+        int corner = (int)(AGKPOPHomographyTestsUniform(&seed) * 4.0);
+        double dx = (AGKPOPHomographyTestsUniform(&seed) - 0.5) * 10.0;
+        double dy = (AGKPOPHomographyTestsUniform(&seed) - 0.5) * 10.0;
+
+        // Keep the corners within 40 points of the rect so the quad stays sane
+        double x = quad[2 * corner] + dx;
+        double y = quad[2 * corner + 1] + dy;
+        if(fabs(x - rect[2 * corner]) > 40.0 || fabs(y - rect[2 * corner + 1]) > 40.0)
+        {
+            continue;
+        }
+
+        XCTAssertTrue(AGKPOPHomographyStateMoveCorner(&state, corner, dx, dy));
+        quad[2 * corner] = x;
+        quad[2 * corner + 1] = y;
+
+        double full[9];
+        XCTAssertTrue(AGKPOPHomographyRectToQuad(0.0, 0.0, 200.0, 150.0, quad, full));
+        XCTAssertLessThan(AGKPOPHomographyTestsCornerError(state.h, rect, quad), 1e-6);
+        for(int j = 0; j < 9; j++)
+        {
+            XCTAssertEqualWithAccuracy(state.h[j], full[j], 1e-9 * fmax(1.0, fabs(full[j])));
+        }
+    }
+}
+
+- (void)testDegenerateCornerMoveLeavesStateUntouched
+{
+    const double quad[8] = {0.0, 0.0, 100.0, 0.0, 100.0, 100.0, 0.0, 100.0};
+    AGKPOPHomographyState state;
+    XCTAssertTrue(AGKPOPHomographyStateInit(&state, 0.0, 0.0, 100.0, 100.0, quad));
+    AGKPOPHomographyState before = state;
+
+    // Bottom left onto the line through top left and top right
+    XCTAssertFalse(AGKPOPHomographyStateMoveCorner(&state, 3, 200.0, -100.0));
+    XCTAssertEqual(memcmp(&state, &before, sizeof(state)), 0);
+}
+
+- (void)testDegenerateQuadIsRejected
+{
+    // Top left, top right and bottom right on one line
+    const double quad[8] = {0.0, 0.0, 100.0, 100.0, 200.0, 200.0, 0.0, 100.0};
+    const double square[8] = {0.0, 0.0, 1.0, 0.0, 1.0, 1.0, 0.0, 1.0};
+    double h[9] = {1, 2, 3, 4, 5, 6, 7, 8, 9};
+
+    XCTAssertFalse(AGKPOPHomographySquareToQuad(quad, h));
+    XCTAssertFalse(AGKPOPHomographyQuadToQuad(quad, square, h));
+    for(int i = 0; i < 9; i++)
+    {
+        XCTAssertEqual(h[i], (double)(i + 1));
+    }
+}
+
+@end
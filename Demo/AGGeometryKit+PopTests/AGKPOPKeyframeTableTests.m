@@ -0,0 +1,81 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <XCTest/XCTest.h>
+#import "CALayer+AGKPOPKeyframes.h"
+
+static double (^AGKPOPKeyframeTableTestsPowerCurve(double exponent))(double p)
+{
+    // Captures exponent, so every call returns a new block
+    return [^double(double p) { return pow(p, exponent); } copy];
+}
+
+@interface AGKPOPKeyframeTableTests : XCTestCase
+
+@end
+
+@implementation AGKPOPKeyframeTableTests
+
+- (void)setUp
+{
+    [super setUp];
+    [AGKPOPKeyframeTable removeAllCachedTables];
+}
+
+- (void)testBlocksWithTheSameCurveShareATable
+{
+    AGKQuad from = AGKQuadMakeWithCGRect(CGRectMake(0.0, 0.0, 200.0, 150.0));
+    AGKQuad to = AGKQuadMake(CGPointMake(10.0, 5.0), CGPointMake(190.0, 20.0), CGPointMake(210.0, 160.0), CGPointMake(-5.0, 140.0));
+    double (^first)(double p) = AGKPOPKeyframeTableTestsPowerCurve(2.0);
+    double (^second)(double p) = AGKPOPKeyframeTableTestsPowerCurve(2.0);
+    XCTAssertNotEqual((__bridge void *)first, (__bridge void *)second);
+
+    AGKPOPKeyframeTable *a = [AGKPOPKeyframeTable tableBetweenQuadrilateral:from andQuadrilateral:to layerSize:CGSizeMake(200.0, 150.0) layerPosition:CGPointZero forNumberOfFrames:60 easeFunction:first];
+    AGKPOPKeyframeTable *b = [AGKPOPKeyframeTable tableBetweenQuadrilateral:from andQuadrilateral:to layerSize:CGSizeMake(200.0, 150.0) layerPosition:CGPointZero forNumberOfFrames:60 easeFunction:second];
+    XCTAssertEqual(a, b);
+}
+
+- (void)testDifferentCurvesGetDifferentTables
+{
+    AGKQuad from = AGKQuadMakeWithCGRect(CGRectMake(0.0, 0.0, 200.0, 150.0));
+    AGKQuad to = AGKQuadMake(CGPointMake(10.0, 5.0), CGPointMake(190.0, 20.0), CGPointMake(210.0, 160.0), CGPointMake(-5.0, 140.0));
+
+    AGKPOPKeyframeTable *a = [AGKPOPKeyframeTable tableBetweenQuadrilateral:from andQuadrilateral:to layerSize:CGSizeMake(200.0, 150.0) layerPosition:CGPointZero forNumberOfFrames:60 easeFunction:AGKPOPKeyframeTableTestsPowerCurve(2.0)];
+    AGKPOPKeyframeTable *b = [AGKPOPKeyframeTable tableBetweenQuadrilateral:from andQuadrilateral:to layerSize:CGSizeMake(200.0, 150.0) layerPosition:CGPointZero forNumberOfFrames:60 easeFunction:AGKPOPKeyframeTableTestsPowerCurve(3.0)];
+    XCTAssertNotEqual(a, b);
+    XCTAssertEqual(a.count, (NSUInteger)60);
+    XCTAssertEqual(b.count, (NSUInteger)60);
+}
+
+- (void)testMovedQuadsShareATable
+{
+    AGKQuad from = AGKQuadMakeWithCGRect(CGRectMake(0.0, 0.0, 200.0, 150.0));
+    AGKQuad to = AGKQuadMake(CGPointMake(10.0, 5.0), CGPointMake(190.0, 20.0), CGPointMake(210.0, 160.0), CGPointMake(-5.0, 140.0));
+    double (^ease)(double p) = AGKPOPKeyframeTableTestsPowerCurve(2.0);
+
+    AGKPOPKeyframeTable *a = [AGKPOPKeyframeTable tableBetweenQuadrilateral:from andQuadrilateral:to layerSize:CGSizeMake(200.0, 150.0) layerPosition:CGPointZero forNumberOfFrames:60 easeFunction:ease];
+    AGKPOPKeyframeTable *b = [AGKPOPKeyframeTable tableBetweenQuadrilateral:AGKQuadMove(from, 32.0, 64.0) andQuadrilateral:AGKQuadMove(to, 32.0, 64.0) layerSize:CGSizeMake(200.0, 150.0) layerPosition:CGPointMake(32.0, 64.0) forNumberOfFrames:60 easeFunction:ease];
+    XCTAssertEqual(a, b);
+}
+
+@end
@@ -0,0 +1,269 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <XCTest/XCTest.h>
+#import "AGKPOPMatrix.h"
+
+#define kAGKPOPMatrixTestsMaxDimension 12
+
+static double AGKPOPMatrixTestsUniform(uint32_t *state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return (*state >> 8) / (double)(1u << 24);
+}
+
+// Random entries in [-1, 1] plus n on the diagonal, so the matrix is well
+// conditioned and the residuals below only measure rounding
+static void AGKPOPMatrixTestsRandom(uint32_t *seed, size_t n, double *m)
+{
+    for(size_t i = 0; i < n * n; i++)
+    {
+        m[i] = AGKPOPMatrixTestsUniform(seed) * 2.0 - 1.0;
+    }
+    for(size_t i = 0; i < n; i++)
+    {
+        m[i * n + i] += (double)n;
+    }
+}
+
+static void AGKPOPMatrixTestsMultiply(const double *a, const double *b, size_t rows, size_t inner, size_t cols, double *out)
+{
+    for(size_t row = 0; row < rows; row++)
+    {
+        for(size_t col = 0; col < cols; col++)
+        {
+            double sum = 0.0;
+            for(size_t k = 0; k < inner; k++)
+            {
+                sum += a[row * inner + k] * b[k * cols + col];
+            }
+            out[row * cols + col] = sum;
+        }
+    }
+}
+
+// Largest difference between m * other and scale times the identity
+static double AGKPOPMatrixTestsIdentityResidual(const double *m, const double *other, size_t n, double scale)
+{
+    double product[kAGKPOPMatrixTestsMaxDimension * kAGKPOPMatrixTestsMaxDimension];
+    AGKPOPMatrixTestsMultiply(m, other, n, n, n, product);
+
+    double residual = 0.0;
+    for(size_t row = 0; row < n; row++)
+    {
+        for(size_t col = 0; col < n; col++)
+        {
+            double expected = row == col ? scale : 0.0;
+            residual = fmax(residual, fabs(product[row * n + col] - expected));
+        }
+    }
+    return residual;
+}
+
+@interface AGKPOPMatrixTests : XCTestCase
+
+@end
+
+@implementation AGKPOPMatrixTests
+
+- (void)testTranspose
+{
+    const double m[6] = {1, 2, 3, 4, 5, 6};
+    const double expected[6] = {1, 4, 2, 5, 3, 6};
+    double out[6];
+    AGKPOPMatrixTranspose(m, 2, 3, out);
+    XCTAssertEqual(memcmp(out, expected, sizeof(out)), 0);
+
+    double square[9] = {1, 2, 3, 4, 5, 6, 7, 8, 9};
+    const double transposed[9] = {1, 4, 7, 2, 5, 8, 3, 6, 9};
+    AGKPOPMatrixTranspose(square, 3, 3, square);
+    XCTAssertEqual(memcmp(square, transposed, sizeof(square)), 0);
+}
+
+- (void)testMultiply
+{
+    uint32_t seed = 1;
+    double a[5 * 7], b[7 * 3], out[5 * 3], expected[5 * 3];
+    for(size_t i = 0; i < 5 * 7; i++)
+    {
+        a[i] = AGKPOPMatrixTestsUniform(&seed);
+    }
+    for(size_t i = 0; i < 7 * 3; i++)
+    {
+        b[i] = AGKPOPMatrixTestsUniform(&seed);
+    }
+
+    AGKPOPMatrixMultiply(a, b, 5, 7, 3, out);
+    AGKPOPMatrixTestsMultiply(a, b, 5, 7, 3, expected);
+    for(size_t i = 0; i < 5 * 3; i++)
+    {
+        XCTAssertEqualWithAccuracy(out[i], expected[i], 1e-14);
+    }
+}
+
+- (void)test3x3MatchesGeneralSize
+{
+    uint32_t seed = 2;
+    double a[9], b[9];
+    AGKPOPMatrixTestsRandom(&seed, 3, a);
+    AGKPOPMatrixTestsRandom(&seed, 3, b);
+
+    double product[9], expected[9];
+    AGKPOPMatrix3x3Multiply(a, b, product);
+    AGKPOPMatrixMultiply(a, b, 3, 3, 3, expected);
+    for(size_t i = 0; i < 9; i++)
+    {
+        XCTAssertEqualWithAccuracy(product[i], expected[i], 1e-13);
+    }
+
+    double inverse[9], general[9];
+    XCTAssertTrue(AGKPOPMatrix3x3Invert(a, inverse));
+    XCTAssertTrue(AGKPOPMatrixInvert(a, 3, general));
+    for(size_t i = 0; i < 9; i++)
+    {
+        XCTAssertEqualWithAccuracy(inverse[i], general[i], 1e-14);
+    }
+}
+
+- (void)testDeterminant
+{
+    const double triangular[16] = {2, 7, 1, 8, 0, 3, 2, 8, 0, 0, -1, 4, 0, 0, 0, 5};
+    XCTAssertEqualWithAccuracy(AGKPOPMatrixDeterminant(triangular, 4), -30.0, 1e-12);
+
+    const double singular[16] = {1, 2, 3, 4, 2, 4, 6, 8, 0, 1, 0, 1, 5, 5, 5, 5};
+    XCTAssertEqual(AGKPOPMatrixDeterminant(singular, 4), 0.0);
+
+    // det(a * b) = det(a) * det(b), also above the stack limit
+    uint32_t seed = 3;
+    for(size_t n = 1; n <= kAGKPOPMatrixTestsMaxDimension; n++)
+    {
+        double a[kAGKPOPMatrixTestsMaxDimension * kAGKPOPMatrixTestsMaxDimension];
+        double b[kAGKPOPMatrixTestsMaxDimension * kAGKPOPMatrixTestsMaxDimension];
+        double ab[kAGKPOPMatrixTestsMaxDimension * kAGKPOPMatrixTestsMaxDimension];
+        AGKPOPMatrixTestsRandom(&seed, n, a);
+        AGKPOPMatrixTestsRandom(&seed, n, b);
+        AGKPOPMatrixTestsMultiply(a, b, n, n, n, ab);
+
+        double expected = AGKPOPMatrixDeterminant(a, n) * AGKPOPMatrixDeterminant(b, n);
+        XCTAssertEqualWithAccuracy(AGKPOPMatrixDeterminant(ab, n), expected, 1e-12 * fabs(expected));
+    }
+}
+
+- (void)testInvertAndSolve
+{
+    uint32_t seed = 4;
+    for(size_t n = 1; n <= kAGKPOPMatrixTestsMaxDimension; n++)
+    {
+        double m[kAGKPOPMatrixTestsMaxDimension * kAGKPOPMatrixTestsMaxDimension];
+        double inverse[kAGKPOPMatrixTestsMaxDimension * kAGKPOPMatrixTestsMaxDimension];
+        AGKPOPMatrixTestsRandom(&seed, n, m);
+
+        XCTAssertTrue(AGKPOPMatrixInvert(m, n, inverse));
+        XCTAssertLessThan(AGKPOPMatrixTestsIdentityResidual(m, inverse, n, 1.0), 1e-13);
+
+        double b[kAGKPOPMatrixTestsMaxDimension], x[kAGKPOPMatrixTestsMaxDimension], mx[kAGKPOPMatrixTestsMaxDimension];
+        for(size_t i = 0; i < n; i++)
+        {
+            b[i] = AGKPOPMatrixTestsUniform(&seed) * 10.0;
+        }
+        XCTAssertTrue(AGKPOPMatrixSolve(m, b, n, x));
+        AGKPOPMatrixTestsMultiply(m, x, n, n, 1, mx);
+        for(size_t i = 0; i < n; i++)
+        {
+            XCTAssertEqualWithAccuracy(mx[i], b[i], 1e-13);
+        }
+    }
+}
+
+- (void)testSingularMatrixIsRejected
+{
+    const double singular[9] = {1, 2, 3, 2, 4, 6, 1, 0, 1};
+    double out[9] = {7, 7, 7, 7, 7, 7, 7, 7, 7};
+    const double untouched[9] = {7, 7, 7, 7, 7, 7, 7, 7, 7};
+    double b[3] = {1, 2, 3};
+
+    XCTAssertFalse(AGKPOPMatrixInvert(singular, 3, out));
+    XCTAssertFalse(AGKPOPMatrix3x3Invert(singular, out));
+    XCTAssertEqual(memcmp(out, untouched, sizeof(out)), 0);
+    XCTAssertFalse(AGKPOPMatrixSolve(singular, b, 3, b));
+}
+
+- (void)testCofactor
+{
+    // m * adjugate = det(m) * I, with the adjugate the transposed cofactors
+    uint32_t seed = 5;
+    for(size_t n = 1; n <= 10; n++)
+    {
+        double m[kAGKPOPMatrixTestsMaxDimension * kAGKPOPMatrixTestsMaxDimension];
+        double adjugate[kAGKPOPMatrixTestsMaxDimension * kAGKPOPMatrixTestsMaxDimension];
+        AGKPOPMatrixTestsRandom(&seed, n, m);
+
+        XCTAssertTrue(AGKPOPMatrixCofactor(m, n, adjugate));
+        AGKPOPMatrixTranspose(adjugate, n, n, adjugate);
+        double det = AGKPOPMatrixDeterminant(m, n);
+        XCTAssertLessThan(AGKPOPMatrixTestsIdentityResidual(m, adjugate, n, det), 1e-13 * fabs(det));
+    }
+}
+
+- (void)testGivensRotations
+{
+    double c, s;
+    AGKPOPMatrixGivens(3.0, 4.0, &c, &s);
+    XCTAssertEqualWithAccuracy(c * c + s * s, 1.0, 1e-14);
+    XCTAssertEqualWithAccuracy(c * 3.0 + s * 4.0, 5.0, 1e-14);
+    XCTAssertEqualWithAccuracy(-s * 3.0 + c * 4.0, 0.0, 1e-14);
+
+    AGKPOPMatrixGivens(2.0, 0.0, &c, &s);
+    XCTAssertEqual(c, 1.0);
+    XCTAssertEqual(s, 0.0);
+
+    // Rotating rows 1 and 3 is G * m, rotating columns is m * G^T
+    uint32_t seed = 6;
+    double m[16], g[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+    AGKPOPMatrixTestsRandom(&seed, 4, m);
+    AGKPOPMatrixGivens(m[1 * 4 + 0], m[3 * 4 + 0], &c, &s);
+    g[1 * 4 + 1] = c;
+    g[1 * 4 + 3] = s;
+    g[3 * 4 + 1] = -s;
+    g[3 * 4 + 3] = c;
+
+    double rows[16], expectedRows[16];
+    memcpy(rows, m, sizeof(m));
+    AGKPOPMatrixRotateRows(rows, 4, 1, 3, c, s);
+    AGKPOPMatrixTestsMultiply(g, m, 4, 4, 4, expectedRows);
+    XCTAssertEqualWithAccuracy(rows[3 * 4 + 0], 0.0, 1e-14);
+
+    double columns[16], gT[16], expectedColumns[16];
+    memcpy(columns, m, sizeof(m));
+    AGKPOPMatrixRotateColumns(columns, 4, 4, 1, 3, c, s);
+    AGKPOPMatrixTranspose(g, 4, 4, gT);
+    AGKPOPMatrixTestsMultiply(m, gT, 4, 4, 4, expectedColumns);
+
+    for(size_t i = 0; i < 16; i++)
+    {
+        XCTAssertEqualWithAccuracy(rows[i], expectedRows[i], 1e-14);
+        XCTAssertEqualWithAccuracy(columns[i], expectedColumns[i], 1e-14);
+    }
+}
+
+@end
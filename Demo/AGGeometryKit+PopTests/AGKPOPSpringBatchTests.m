@@ -0,0 +1,112 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <XCTest/XCTest.h>
+#import "AGKPOPSpring.h"
+#import "AGKPOPSpringBatch.h"
+
+static double AGKPOPSpringBatchTestsUniform(uint32_t *state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return (*state >> 8) / (double)(1u << 24);
+}
+
+// Advances count springs of dimension 3, an odd number of components per spring, by a
+// few frames of different length and compares every component with AGKPOPSpringStepApply
+static void AGKPOPSpringBatchTestsCompareWithStepApply(size_t count, bool parallel, double *maxError)
+{
+    // Under-, critically and overdamped
+    const double constants[][3] = {{300.0, 10.0, 1.0}, {100.0, 20.0, 1.0}, {50.0, 40.0, 2.0}};
+    const double frames[] = {1.0 / 60.0, 1.0 / 60.0, 1.0 / 120.0, 0.005, 1.0 / 60.0};
+    const size_t dimension = 3;
+
+    AGKPOPSpringBatch *batch = AGKPOPSpringBatchCreate(dimension);
+    AGKPOPSpringBatchSetParallel(batch, parallel);
+    AGKPOPSpringBatchHandle *handles = malloc(count * sizeof(AGKPOPSpringBatchHandle));
+    double *p = malloc(count * dimension * sizeof(double));
+    double *v = malloc(count * dimension * sizeof(double));
+
+    uint32_t seed = 1;
+    for(size_t spring = 0; spring < count; spring++)
+    {
+        const double *k = constants[spring % 3];
+        handles[spring] = AGKPOPSpringBatchAdd(batch, k[0], k[1], k[2]);
+        double *bp = AGKPOPSpringBatchPositions(batch, handles[spring]);
+        double *bv = AGKPOPSpringBatchVelocities(batch, handles[spring]);
+        for(size_t i = 0; i < dimension; i++)
+        {
+            p[spring * dimension + i] = bp[i] = (AGKPOPSpringBatchTestsUniform(&seed) - 0.5) * 200.0;
+            v[spring * dimension + i] = bv[i] = (AGKPOPSpringBatchTestsUniform(&seed) - 0.5) * 1000.0;
+        }
+    }
+
+    *maxError = 0.0;
+    for(size_t frame = 0; frame < sizeof(frames) / sizeof(frames[0]); frame++)
+    {
+        AGKPOPSpringBatchAdvance(batch, frames[frame]);
+        for(size_t spring = 0; spring < count; spring++)
+        {
+            const double *k = constants[spring % 3];
+            AGKPOPSpringStep step = AGKPOPSpringStepMake(k[0], k[1], k[2], frames[frame]);
+            const double *bp = AGKPOPSpringBatchPositions(batch, handles[spring]);
+            const double *bv = AGKPOPSpringBatchVelocities(batch, handles[spring]);
+            for(size_t i = 0; i < dimension; i++)
+            {
+                size_t lane = spring * dimension + i;
+                AGKPOPSpringStepApply(step, &p[lane], &v[lane]);
+                // Relative, NEON fuses the multiply and add
+                *maxError = fmax(*maxError, fabs(bp[i] - p[lane]) / fmax(1.0, fabs(p[lane])));
+                *maxError = fmax(*maxError, fabs(bv[i] - v[lane]) / fmax(1.0, fabs(v[lane])));
+            }
+        }
+    }
+
+    AGKPOPSpringBatchDestroy(batch);
+    free(handles);
+    free(p);
+    free(v);
+}
+
+@interface AGKPOPSpringBatchTests : XCTestCase
+
+@end
+
+@implementation AGKPOPSpringBatchTests
+
+- (void)testOddBatchMatchesStepApply
+{
+    // 15 components, so the last one is left over by the two-lane kernel
+    double maxError;
+    AGKPOPSpringBatchTestsCompareWithStepApply(5, false, &maxError);
+    XCTAssertLessThan(maxError, 1e-12);
+}
+
+- (void)testParallelOddBatchMatchesStepApply
+{
+    // 65541 components, more than the parallel minimum and not a whole number of chunks
+    double maxError;
+    AGKPOPSpringBatchTestsCompareWithStepApply(21847, true, &maxError);
+    XCTAssertLessThan(maxError, 1e-12);
+}
+
+@end
@@ -0,0 +1,165 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <XCTest/XCTest.h>
+#import "AGKPOPSpring.h"
+
+// POP integrates the spring with RK4 in steps of 1 ms, see POPSpringSolver.h
+static void AGKPOPSpringTestsRK4(double k, double b, double m, double *p, double *v, double t)
+{
+    const double dt = 0.001;
+    long steps = lround(t / dt);
+    for(long i = 0; i < steps; i++)
+    {
+        double ap = *v;
+        double av = (-k * *p - b * *v) / m;
+        double bp = *v + av * dt / 2.0;
+        double bv = (-k * (*p + ap * dt / 2.0) - b * (*v + av * dt / 2.0)) / m;
+        double cp = *v + bv * dt / 2.0;
+        double cv = (-k * (*p + bp * dt / 2.0) - b * (*v + bv * dt / 2.0)) / m;
+        double dp = *v + cv * dt;
+        double dv = (-k * (*p + cp * dt) - b * (*v + cv * dt)) / m;
+        *p += (ap + 2.0 * bp + 2.0 * cp + dp) / 6.0 * dt;
+        *v += (av + 2.0 * bv + 2.0 * cv + dv) / 6.0 * dt;
+    }
+}
+
+// Largest difference in position and velocity over 120 frames of 16 ms
+static void AGKPOPSpringTestsCompareWithRK4(double k, double b, double m, double *positionError, double *velocityError)
+{
+    double p = 100.0, v = -50.0;
+    double rp = p, rv = v;
+    AGKPOPSpringStep step = AGKPOPSpringStepMake(k, b, m, 0.016);
+
+    *positionError = 0.0;
+    *velocityError = 0.0;
+    for(int frame = 0; frame < 120; frame++)
+    {
+        AGKPOPSpringStepApply(step, &p, &v);
+        AGKPOPSpringTestsRK4(k, b, m, &rp, &rv, 0.016);
+        *positionError = fmax(*positionError, fabs(p - rp));
+        *velocityError = fmax(*velocityError, fabs(v - rv));
+    }
+}
+
+@interface AGKPOPSpringTests : XCTestCase
+
+@end
+
+@implementation AGKPOPSpringTests
+
+- (void)testUnderdampedMatchesRK4
+{
+    double positionError, velocityError;
+    AGKPOPSpringTestsCompareWithRK4(300.0, 10.0, 1.0, &positionError, &velocityError);
+    XCTAssertLessThan(positionError, 1e-6);
+    XCTAssertLessThan(velocityError, 1e-4);
+}
+
+- (void)testCriticallyDampedMatchesRK4
+{
+    double positionError, velocityError;
+    AGKPOPSpringTestsCompareWithRK4(100.0, 20.0, 1.0, &positionError, &velocityError);
+    XCTAssertLessThan(positionError, 1e-6);
+    XCTAssertLessThan(velocityError, 1e-4);
+}
+
+- (void)testOverdampedMatchesRK4
+{
+    double positionError, velocityError;
+    AGKPOPSpringTestsCompareWithRK4(100.0, 40.0, 1.0, &positionError, &velocityError);
+    XCTAssertLessThan(positionError, 1e-6);
+    XCTAssertLessThan(velocityError, 1e-4);
+}
+
+- (void)testEvaluateMatchesSteps
+{
+    double p = 100.0, v = -50.0;
+    AGKPOPSpringStep step = AGKPOPSpringStepMake(500.0, 5.0, 2.0, 0.016);
+    for(int frame = 0; frame < 125; frame++)
+    {
+        AGKPOPSpringStepApply(step, &p, &v);
+    }
+
+    double ep, ev;
+    AGKPOPSpringEvaluate(500.0, 5.0, 2.0, 100.0, -50.0, 2.0, &ep, &ev);
+    XCTAssertEqualWithAccuracy(ep, p, 1e-9);
+    XCTAssertEqualWithAccuracy(ev, v, 1e-9);
+}
+
+- (void)testConvergesLikePOP
+{
+    double p = 100.0, v = 0.0;
+    AGKPOPSpringStep step = AGKPOPSpringStepMake(300.0, 10.0, 1.0, 0.016);
+    XCTAssertFalse(AGKPOPSpringHasConverged(&p, &v, 1, 300.0, 10.0, 1.0, 1.0));
+    for(int frame = 0; frame < 600; frame++)
+    {
+        AGKPOPSpringStepApply(step, &p, &v);
+    }
+    XCTAssertTrue(AGKPOPSpringHasConverged(&p, &v, 1, 300.0, 10.0, 1.0, 1.0));
+}
+
+- (void)testPerformanceClosedForm
+{
+    // 1000 coordinates for one second at 60 fps
+    [self measureBlock:^{
+        double p[1000], v[1000];
+        for(int i = 0; i < 1000; i++)
+        {
+            p[i] = i;
+            v[i] = 0.0;
+        }
+        AGKPOPSpringStep step = AGKPOPSpringStepMake(300.0, 10.0, 1.0, 1.0 / 60.0);
+        for(int frame = 0; frame < 60; frame++)
+        {
+            for(int i = 0; i < 1000; i++)
+            {
+                AGKPOPSpringStepApply(step, &p[i], &v[i]);
+            }
+        }
+        XCTAssertTrue(fabs(p[999]) < 1000.0);
+    }];
+}
+
+- (void)testPerformanceRK4
+{
+    // Same work as testPerformanceClosedForm, integrated the way POP does it
+    [self measureBlock:^{
+        double p[1000], v[1000];
+        for(int i = 0; i < 1000; i++)
+        {
+            p[i] = i;
+            v[i] = 0.0;
+        }
+        for(int frame = 0; frame < 60; frame++)
+        {
+            for(int i = 0; i < 1000; i++)
+            {
+                AGKPOPSpringTestsRK4(300.0, 10.0, 1.0, &p[i], &v[i], 1.0 / 60.0);
+            }
+        }
+        XCTAssertTrue(fabs(p[999]) < 1000.0);
+    }];
+}
+
+@end
@@ -0,0 +1,743 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <XCTest/XCTest.h>
+#import "AGKPOPWarp.h"
+
+static uint32_t AGKPOPWarpTestsRandom(uint32_t *state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+static double AGKPOPWarpTestsUniform(uint32_t *state)
+{
+    return AGKPOPWarpTestsRandom(state) / (double)(1u << 24);
+}
+
+// Random premultiplied RGBA, so every filter sees valid input
+static AGKPOPWarpBitmap AGKPOPWarpTestsCreateBitmap(size_t width, size_t height, uint32_t seed)
+{
+    AGKPOPWarpBitmap bitmap = {malloc(width * height * 4), width, height, width * 4};
+    for(size_t i = 0; i < width * height; i++)
+    {
+        uint8_t alpha = (uint8_t)AGKPOPWarpTestsRandom(&seed);
+        for(size_t c = 0; c < 3; c++)
+        {
+            bitmap.data[i * 4 + c] = (uint8_t)(AGKPOPWarpTestsRandom(&seed) % (alpha + 1u));
+        }
+        bitmap.data[i * 4 + 3] = alpha;
+    }
+    return bitmap;
+}
+
+// Compares a nearest warp with projecting every pixel on its own. Pixels whose
+// source position is within 1e-6 of a pixel edge are skipped, the kernel steps
+// the projection along the row and may round those to the other side.
+static size_t AGKPOPWarpTestsNearestMismatches(const AGKPOPWarpBitmap *source, const AGKPOPWarpBitmap *destination,
+                                              const double m[9], size_t *checked)
+{
+    size_t mismatches = 0;
+    *checked = 0;
+    for(size_t y = 0; y < destination->height; y++)
+    {
+        for(size_t x = 0; x < destination->width; x++)
+        {
+            double W = m[6] * x + m[7] * y + m[8];
+            double sx = (m[0] * x + m[1] * y + m[2]) / W;
+            double sy = (m[3] * x + m[4] * y + m[5]) / W;
+            if(!isfinite(sx) || !isfinite(sy) || fabs(sx - round(sx)) < 1e-6 || fabs(sy - round(sy)) < 1e-6)
+            {
+                continue;
+            }
+
+            uint8_t expected[4] = {0, 0, 0, 0};
+            if(sx >= 0.0 && sx < source->width && sy >= 0.0 && sy < source->height)
+            {
+                memcpy(expected, source->data + (size_t)sy * source->bytesPerRow + (size_t)sx * 4, 4);
+            }
+            mismatches += memcmp(expected, destination->data + y * destination->bytesPerRow + x * 4, 4) != 0;
+            (*checked)++;
+        }
+    }
+    return mismatches;
+}
+
+// Number of pixels whose filter center projects outside the source, more than
+// 1e-6 from its edges, that were not cleared
+static size_t AGKPOPWarpTestsUnclearedOutside(const AGKPOPWarpBitmap *source, const AGKPOPWarpBitmap *destination,
+                                             const double m[9], double center)
+{
+    static const uint8_t clear[4] = {0, 0, 0, 0};
+    size_t uncleared = 0;
+    for(size_t y = 0; y < destination->height; y++)
+    {
+        for(size_t x = 0; x < destination->width; x++)
+        {
+            double W = m[6] * (x + center) + m[7] * (y + center) + m[8];
+            double sx = (m[0] * (x + center) + m[1] * (y + center) + m[2]) / W;
+            double sy = (m[3] * (x + center) + m[4] * (y + center) + m[5]) / W;
+            bool outside = sx < -1e-6 || sx > source->width + 1e-6 || sy < -1e-6 || sy > source->height + 1e-6;
+            if(outside && memcmp(destination->data + y * destination->bytesPerRow + x * 4, clear, 4) != 0)
+            {
+                uncleared++;
+            }
+        }
+    }
+    return uncleared;
+}
+
+typedef struct AGKPOPWarpTestsTiles {
+    const AGKPOPWarpBitmap *source;
+    const AGKPOPWarpBitmap *destination;
+    size_t reads;
+    bool readOutside;
+    bool failWrite;
+} AGKPOPWarpTestsTiles;
+
+static bool AGKPOPWarpTestsReadTile(void *context, const AGKPOPWarpBitmap *tile, size_t x, size_t y)
+{
+    AGKPOPWarpTestsTiles *tiles = context;
+    tiles->reads++;
+    if(x + tile->width > tiles->source->width || y + tile->height > tiles->source->height)
+    {
+        tiles->readOutside = true;
+        return false;
+    }
+    for(size_t row = 0; row < tile->height; row++)
+    {
+        memcpy(tile->data + row * tile->bytesPerRow,
+               tiles->source->data + (y + row) * tiles->source->bytesPerRow + x * 4,
+               tile->width * 4);
+    }
+    return true;
+}
+
+static bool AGKPOPWarpTestsWriteTile(void *context, const AGKPOPWarpBitmap *tile, size_t x, size_t y)
+{
+    AGKPOPWarpTestsTiles *tiles = context;
+    if(tiles->failWrite)
+    {
+        return false;
+    }
+    for(size_t row = 0; row < tile->height; row++)
+    {
+        memcpy(tiles->destination->data + (y + row) * tiles->destination->bytesPerRow + x * 4,
+               tile->data + row * tile->bytesPerRow,
+               tile->width * 4);
+    }
+    return true;
+}
+
+static bool AGKPOPWarpTestsWarpTiled(const AGKPOPWarpBitmap *source, const AGKPOPWarpBitmap *destination,
+                                     const double m[9], const AGKPOPWarpOptions *options,
+                                     size_t tileSize, size_t maxSourceTileBytes, AGKPOPWarpTestsTiles *tiles)
+{
+    tiles->source = source;
+    tiles->destination = destination;
+    AGKPOPWarpTiling tiling = {
+        source->width, source->height,
+        destination->width, destination->height,
+        tileSize, maxSourceTileBytes,
+        AGKPOPWarpTestsReadTile, AGKPOPWarpTestsWriteTile, tiles,
+    };
+    return AGKPOPWarpTiled(&tiling, m, options);
+}
+
+// A plane of random bytes with a few bytes of padding at the end of every row
+static AGKPOPWarpPlane AGKPOPWarpTestsCreatePlane(size_t width, size_t height, uint32_t seed)
+{
+    AGKPOPWarpPlane plane = {malloc((width + 3) * height), width + 3};
+    for(size_t i = 0; i < plane.bytesPerRow * height; i++)
+    {
+        plane.data[i] = (uint8_t)AGKPOPWarpTestsRandom(&seed);
+    }
+    return plane;
+}
+
+static AGKPOPWarpBuffer AGKPOPWarpTestsCreateBuffer(AGKPOPWarpPixelFormat format, size_t width, size_t height, uint32_t seed)
+{
+    AGKPOPWarpBuffer buffer = {format, width, height, {{NULL, 0}, {NULL, 0}, {NULL, 0}}};
+    size_t chromaWidth = (width + 1) / 2;
+    size_t chromaHeight = (height + 1) / 2;
+    buffer.planes[0] = AGKPOPWarpTestsCreatePlane(width, height, seed);
+    if(format == AGKPOPWarpPixelFormatYUV420)
+    {
+        buffer.planes[1] = AGKPOPWarpTestsCreatePlane(chromaWidth, chromaHeight, seed + 1);
+        buffer.planes[2] = AGKPOPWarpTestsCreatePlane(chromaWidth, chromaHeight, seed + 2);
+    }
+    else if(format == AGKPOPWarpPixelFormatYUV420BiPlanar)
+    {
+        buffer.planes[1] = AGKPOPWarpTestsCreatePlane(chromaWidth * 2, chromaHeight, seed + 1);
+    }
+    return buffer;
+}
+
+static void AGKPOPWarpTestsDestroyBuffer(AGKPOPWarpBuffer *buffer)
+{
+    for(size_t plane = 0; plane < 3; plane++)
+    {
+        free(buffer->planes[plane].data);
+    }
+}
+
+// Warps one plane on its own as Gray8
+static void AGKPOPWarpTestsWarpGray(AGKPOPWarpPlane source, size_t sourceWidth, size_t sourceHeight,
+                                    AGKPOPWarpPlane destination, size_t destinationWidth, size_t destinationHeight,
+                                    const double matrix[9], const AGKPOPWarpOptions *options)
+{
+    AGKPOPWarpBuffer from = {AGKPOPWarpPixelFormatGray8, sourceWidth, sourceHeight, {source}};
+    AGKPOPWarpBuffer to = {AGKPOPWarpPixelFormatGray8, destinationWidth, destinationHeight, {destination}};
+    AGKPOPWarpBuffers(&from, &to, matrix, options);
+}
+
+// Compares a warped chroma plane, every stride bytes starting at offset, with
+// a Gray8 warp of the source chroma plane using the matrix documented in
+// AGKPOPWarp.h. A Gray8 warp clears outside pixels to 0 where chroma is 128,
+// so a warp of an opaque plane tells which pixels are outside.
+static size_t AGKPOPWarpTestsChromaMismatches(AGKPOPWarpPlane source, size_t sourceWidth, size_t sourceHeight,
+                                              const uint8_t *warped, size_t warpedBytesPerRow, size_t stride,
+                                              size_t width, size_t height, const double m[9],
+                                              const AGKPOPWarpOptions *options, size_t *outside)
+{
+    const double chroma[9] = {m[0], m[1], m[2] / 2.0, m[3], m[4], m[5] / 2.0, m[6] * 2.0, m[7] * 2.0, m[8]};
+
+    AGKPOPWarpPlane opaque = {malloc(sourceWidth * sourceHeight), sourceWidth};
+    memset(opaque.data, 255, sourceWidth * sourceHeight);
+    AGKPOPWarpPlane expected = {malloc(width * height), width};
+    AGKPOPWarpPlane mask = {malloc(width * height), width};
+    AGKPOPWarpTestsWarpGray(source, sourceWidth, sourceHeight, expected, width, height, chroma, options);
+    AGKPOPWarpTestsWarpGray(opaque, sourceWidth, sourceHeight, mask, width, height, chroma, options);
+
+    size_t mismatches = 0;
+    *outside = 0;
+    for(size_t y = 0; y < height; y++)
+    {
+        for(size_t x = 0; x < width; x++)
+        {
+            bool inside = mask.data[y * width + x] != 0;
+            uint8_t value = inside ? expected.data[y * width + x] : 128;
+            mismatches += warped[y * warpedBytesPerRow + x * stride] != value;
+            *outside += !inside;
+        }
+    }
+
+    free(opaque.data);
+    free(expected.data);
+    free(mask.data);
+    return mismatches;
+}
+
+// Partly outside the source, and projective so the chroma matrix differs in every element
+static const double kAGKPOPWarpTestsBufferMatrix[9] = {0.9, 0.2, -6.0, -0.15, 1.1, 4.0, 0.0015, -0.001, 1.0};
+
+@interface AGKPOPWarpTests : XCTestCase
+
+@end
+
+@implementation AGKPOPWarpTests
+
+- (void)testIdentityCopiesSource
+{
+    AGKPOPWarpBitmap source = AGKPOPWarpTestsCreateBitmap(131, 97, 1);
+    AGKPOPWarpBitmap destination = AGKPOPWarpTestsCreateBitmap(131, 97, 2);
+    const double identity[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+
+    AGKPOPWarp(&source, &destination, identity, NULL);
+    XCTAssertEqual(memcmp(source.data, destination.data, 131 * 97 * 4), 0);
+
+    free(source.data);
+    free(destination.data);
+}
+
+- (void)testNearestMatchesFullProjection
+{
+    AGKPOPWarpBitmap source = AGKPOPWarpTestsCreateBitmap(200, 150, 3);
+    AGKPOPWarpBitmap destination = AGKPOPWarpTestsCreateBitmap(230, 170, 4);
+    uint32_t seed = 5;
+
+    for(int i = 0; i < 50; i++)
+    {
+        double m[9] = {
+            0.5 + AGKPOPWarpTestsUniform(&seed), AGKPOPWarpTestsUniform(&seed) - 0.5, AGKPOPWarpTestsUniform(&seed) * 60.0 - 30.0,
+            AGKPOPWarpTestsUniform(&seed) - 0.5, 0.5 + AGKPOPWarpTestsUniform(&seed), AGKPOPWarpTestsUniform(&seed) * 60.0 - 30.0,
+            (AGKPOPWarpTestsUniform(&seed) - 0.5) * 0.004, (AGKPOPWarpTestsUniform(&seed) - 0.5) * 0.004, 1.0,
+        };
+        AGKPOPWarp(&source, &destination, m, NULL);
+
+        size_t checked;
+        XCTAssertEqual(AGKPOPWarpTestsNearestMismatches(&source, &destination, m, &checked), (size_t)0);
+        XCTAssertGreaterThan(checked, (size_t)(230 * 170 * 9 / 10));
+    }
+
+    free(source.data);
+    free(destination.data);
+}
+
+- (void)testRowsMatchWarp
+{
+    AGKPOPWarpBitmap source = AGKPOPWarpTestsCreateBitmap(120, 90, 6);
+    AGKPOPWarpBitmap whole = AGKPOPWarpTestsCreateBitmap(140, 100, 7);
+    AGKPOPWarpBitmap rows = AGKPOPWarpTestsCreateBitmap(140, 100, 8);
+    const double m[9] = {0.8, 0.2, -5.0, -0.1, 1.1, 3.0, 0.001, -0.0005, 1.0};
+
+    AGKPOPWarp(&source, &whole, m, NULL);
+    AGKPOPWarpRows(&source, &rows, m, NULL, 0, 37);
+    AGKPOPWarpRows(&source, &rows, m, NULL, 37, 100);
+    XCTAssertEqual(memcmp(whole.data, rows.data, 140 * 100 * 4), 0);
+
+    free(source.data);
+    free(whole.data);
+    free(rows.data);
+}
+
+- (void)testPixelsOutsideTheSourceAreCleared
+{
+    AGKPOPWarpBitmap source = AGKPOPWarpTestsCreateBitmap(160, 120, 15);
+    AGKPOPWarpBitmap destination = AGKPOPWarpTestsCreateBitmap(300, 240, 16);
+    uint32_t seed = 17;
+
+    for(int i = 0; i < 60; i++)
+    {
+        // Mostly outside the source, with the horizon inside the destination
+        // every other time so rows get two spans
+        double m[9] = {
+            0.5 + AGKPOPWarpTestsUniform(&seed), AGKPOPWarpTestsUniform(&seed) - 0.5, AGKPOPWarpTestsUniform(&seed) * 200.0 - 100.0,
+            AGKPOPWarpTestsUniform(&seed) - 0.5, 0.5 + AGKPOPWarpTestsUniform(&seed), AGKPOPWarpTestsUniform(&seed) * 200.0 - 100.0,
+            (AGKPOPWarpTestsUniform(&seed) - 0.5) * 0.004, (AGKPOPWarpTestsUniform(&seed) - 0.5) * 0.004, 1.0,
+        };
+        if(i == 0)
+        {
+            // Every row has the spans x < 50 and x > 183 with a gap between them
+            const double twoSpans[9] = {1.0, 0.0, -50.0, 0.6, 0.0, -60.0, 0.01, 0.0, -1.0};
+            memcpy(m, twoSpans, sizeof(m));
+        }
+        else if(i % 2 == 0)
+        {
+            m[6] = (AGKPOPWarpTestsUniform(&seed) - 0.5) * 0.02;
+            m[8] = AGKPOPWarpTestsUniform(&seed) - 0.5;
+        }
+
+        for(int filter = AGKPOPWarpFilterNearest; filter <= AGKPOPWarpFilterBicubic; filter++)
+        {
+            AGKPOPWarpOptions options = {(AGKPOPWarpFilter)filter, false};
+            memset(destination.data, 0xAB, 300 * 240 * 4);
+            AGKPOPWarp(&source, &destination, m, &options);
+
+            double center = filter == AGKPOPWarpFilterNearest ? 0.0 : 0.5;
+            XCTAssertEqual(AGKPOPWarpTestsUnclearedOutside(&source, &destination, m, center), (size_t)0);
+            if(filter == AGKPOPWarpFilterNearest)
+            {
+                size_t checked;
+                XCTAssertEqual(AGKPOPWarpTestsNearestMismatches(&source, &destination, m, &checked), (size_t)0);
+            }
+        }
+    }
+
+    free(source.data);
+    free(destination.data);
+}
+
+- (void)testTiledMatchesUntiled
+{
+    AGKPOPWarpBitmap source = AGKPOPWarpTestsCreateBitmap(300, 220, 9);
+    AGKPOPWarpBitmap whole = AGKPOPWarpTestsCreateBitmap(257, 199, 10);
+    AGKPOPWarpBitmap tiled = AGKPOPWarpTestsCreateBitmap(257, 199, 11);
+    uint32_t seed = 12;
+
+    for(int i = 0; i < 90; i++)
+    {
+        double m[9] = {
+            0.5 + 2.0 * AGKPOPWarpTestsUniform(&seed), AGKPOPWarpTestsUniform(&seed) - 0.5, AGKPOPWarpTestsUniform(&seed) * 100.0 - 50.0,
+            AGKPOPWarpTestsUniform(&seed) - 0.5, 0.5 + 2.0 * AGKPOPWarpTestsUniform(&seed), AGKPOPWarpTestsUniform(&seed) * 100.0 - 50.0,
+            (AGKPOPWarpTestsUniform(&seed) - 0.5) * 0.01, (AGKPOPWarpTestsUniform(&seed) - 0.5) * 0.01, 1.0,
+        };
+        if(i % 3 == 0)
+        {
+            // Puts the horizon of the projection inside the destination
+            m[6] = (AGKPOPWarpTestsUniform(&seed) - 0.5) * 0.02;
+            m[8] = AGKPOPWarpTestsUniform(&seed) - 0.3;
+        }
+        AGKPOPWarpOptions options = {(AGKPOPWarpFilter)(i % 3), false};
+        AGKPOPWarp(&source, &whole, m, &options);
+
+        memset(tiled.data, 0xAB, 257 * 199 * 4);
+        AGKPOPWarpTestsTiles tiles = {0};
+        XCTAssertTrue(AGKPOPWarpTestsWarpTiled(&source, &tiled, m, &options, 16 + i % 64, i % 2 ? 2048 : 0, &tiles));
+        XCTAssertFalse(tiles.readOutside);
+        XCTAssertEqual(memcmp(whole.data, tiled.data, 257 * 199 * 4), 0);
+    }
+
+    free(source.data);
+    free(whole.data);
+    free(tiled.data);
+}
+
+- (void)testTiledStopsWhenWriteFails
+{
+    AGKPOPWarpBitmap source = AGKPOPWarpTestsCreateBitmap(64, 64, 13);
+    AGKPOPWarpBitmap destination = AGKPOPWarpTestsCreateBitmap(64, 64, 14);
+    const double identity[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+
+    AGKPOPWarpTestsTiles tiles = {0};
+    tiles.failWrite = true;
+    XCTAssertFalse(AGKPOPWarpTestsWarpTiled(&source, &destination, identity, NULL, 16, 0, &tiles));
+    XCTAssertEqual(tiles.reads, (size_t)1);
+
+    free(source.data);
+    free(destination.data);
+}
+
+- (void)testIntegerTranslationShiftsPixels
+{
+    AGKPOPWarpBitmap source = AGKPOPWarpTestsCreateBitmap(100, 80, 18);
+    AGKPOPWarpBitmap destination = AGKPOPWarpTestsCreateBitmap(120, 70, 19);
+    const int translations[][2] = {{0, 0}, {7, -3}, {-25, 12}, {90, 75}, {-130, 0}};
+
+    for(size_t i = 0; i < sizeof(translations) / sizeof(translations[0]); i++)
+    {
+        int tx = translations[i][0];
+        int ty = translations[i][1];
+        const double m[9] = {1, 0, tx, 0, 1, ty, 0, 0, 1};
+
+        for(int filter = AGKPOPWarpFilterNearest; filter <= AGKPOPWarpFilterBicubic; filter++)
+        {
+            AGKPOPWarpOptions options = {(AGKPOPWarpFilter)filter, false};
+            memset(destination.data, 0xAB, 120 * 70 * 4);
+            AGKPOPWarp(&source, &destination, m, &options);
+
+            size_t mismatches = 0;
+            for(int y = 0; y < 70; y++)
+            {
+                for(int x = 0; x < 120; x++)
+                {
+                    uint8_t expected[4] = {0, 0, 0, 0};
+                    int sx = x + tx;
+                    int sy = y + ty;
+                    if(sx >= 0 && sx < 100 && sy >= 0 && sy < 80)
+                    {
+                        memcpy(expected, source.data + sy * source.bytesPerRow + sx * 4, 4);
+                    }
+                    mismatches += memcmp(expected, destination.data + y * destination.bytesPerRow + x * 4, 4) != 0;
+                }
+            }
+            XCTAssertEqual(mismatches, (size_t)0);
+        }
+    }
+
+    free(source.data);
+    free(destination.data);
+}
+
+- (void)testAffineAndTranslationMatchProjectivePath
+{
+    AGKPOPWarpBitmap source = AGKPOPWarpTestsCreateBitmap(180, 140, 20);
+    AGKPOPWarpBitmap fast = AGKPOPWarpTestsCreateBitmap(200, 150, 21);
+    AGKPOPWarpBitmap projective = AGKPOPWarpTestsCreateBitmap(200, 150, 22);
+    AGKPOPWarpBitmap tiled = AGKPOPWarpTestsCreateBitmap(200, 150, 23);
+    uint32_t seed = 24;
+
+    for(int i = 0; i < 60; i++)
+    {
+        double angle = AGKPOPWarpTestsUniform(&seed) * 6.3;
+        double scale = 0.5 + AGKPOPWarpTestsUniform(&seed) * 1.5;
+        double m[9] = {
+            scale * cos(angle), -scale * sin(angle), AGKPOPWarpTestsUniform(&seed) * 200.0 - 100.0,
+            scale * sin(angle), scale * cos(angle), AGKPOPWarpTestsUniform(&seed) * 200.0 - 100.0,
+            0.0, 0.0, 1.0,
+        };
+        if(i % 4 == 0)
+        {
+            const double translation[6] = {1.0, 0.0, (double)(i - 30), 0.0, 1.0, (double)(20 - i)};
+            memcpy(m, translation, sizeof(translation));
+        }
+
+        // Counts as a projection, but w stays exactly 1 at every pixel
+        double general[9];
+        memcpy(general, m, sizeof(general));
+        general[6] = 1e-300;
+
+        AGKPOPWarpOptions options = {(AGKPOPWarpFilter)(i % 3), false};
+        AGKPOPWarp(&source, &fast, m, &options);
+        AGKPOPWarp(&source, &projective, general, &options);
+        XCTAssertEqual(memcmp(fast.data, projective.data, 200 * 150 * 4), 0);
+
+        AGKPOPWarpTestsTiles tiles = {0};
+        XCTAssertTrue(AGKPOPWarpTestsWarpTiled(&source, &tiled, m, &options, 64, 0, &tiles));
+        XCTAssertEqual(memcmp(tiled.data, projective.data, 200 * 150 * 4), 0);
+    }
+
+    free(source.data);
+    free(fast.data);
+    free(projective.data);
+    free(tiled.data);
+}
+
+- (void)testYUV420PlanesMatchGray8
+{
+    // Odd sizes, so the chroma planes are rounded up
+    AGKPOPWarpBuffer source = AGKPOPWarpTestsCreateBuffer(AGKPOPWarpPixelFormatYUV420, 63, 47, 1);
+    AGKPOPWarpBuffer destination = AGKPOPWarpTestsCreateBuffer(AGKPOPWarpPixelFormatYUV420, 57, 41, 2);
+    const double *m = kAGKPOPWarpTestsBufferMatrix;
+
+    for(int filter = AGKPOPWarpFilterNearest; filter <= AGKPOPWarpFilterBicubic; filter++)
+    {
+        AGKPOPWarpOptions options = {(AGKPOPWarpFilter)filter, false};
+        XCTAssertTrue(AGKPOPWarpBuffers(&source, &destination, m, &options));
+
+        AGKPOPWarpPlane luma = {malloc(57 * 41), 57};
+        AGKPOPWarpTestsWarpGray(source.planes[0], 63, 47, luma, 57, 41, m, &options);
+        size_t mismatches = 0;
+        for(size_t y = 0; y < 41; y++)
+        {
+            mismatches += memcmp(luma.data + y * 57, destination.planes[0].data + y * destination.planes[0].bytesPerRow, 57) != 0;
+        }
+        XCTAssertEqual(mismatches, (size_t)0);
+        free(luma.data);
+
+        for(size_t plane = 1; plane < 3; plane++)
+        {
+            size_t outside;
+            XCTAssertEqual(AGKPOPWarpTestsChromaMismatches(source.planes[plane], 32, 24,
+                                                           destination.planes[plane].data, destination.planes[plane].bytesPerRow, 1,
+                                                           29, 21, m, &options, &outside), (size_t)0);
+            XCTAssertGreaterThan(outside, (size_t)0);
+            XCTAssertLessThan(outside, (size_t)(29 * 21));
+        }
+    }
+
+    AGKPOPWarpTestsDestroyBuffer(&source);
+    AGKPOPWarpTestsDestroyBuffer(&destination);
+}
+
+- (void)testNV12MatchesI420
+{
+    AGKPOPWarpBuffer planar = AGKPOPWarpTestsCreateBuffer(AGKPOPWarpPixelFormatYUV420, 63, 47, 1);
+    AGKPOPWarpBuffer biPlanar = AGKPOPWarpTestsCreateBuffer(AGKPOPWarpPixelFormatYUV420BiPlanar, 63, 47, 1);
+    for(size_t y = 0; y < 24; y++)
+    {
+        for(size_t x = 0; x < 32; x++)
+        {
+            uint8_t *cbcr = biPlanar.planes[1].data + y * biPlanar.planes[1].bytesPerRow + x * 2;
+            cbcr[0] = planar.planes[1].data[y * planar.planes[1].bytesPerRow + x];
+            cbcr[1] = planar.planes[2].data[y * planar.planes[2].bytesPerRow + x];
+        }
+    }
+
+    AGKPOPWarpBuffer planarOut = AGKPOPWarpTestsCreateBuffer(AGKPOPWarpPixelFormatYUV420, 57, 41, 2);
+    AGKPOPWarpBuffer biPlanarOut = AGKPOPWarpTestsCreateBuffer(AGKPOPWarpPixelFormatYUV420BiPlanar, 57, 41, 3);
+    for(int filter = AGKPOPWarpFilterNearest; filter <= AGKPOPWarpFilterBicubic; filter++)
+    {
+        AGKPOPWarpOptions options = {(AGKPOPWarpFilter)filter, false};
+        XCTAssertTrue(AGKPOPWarpBuffers(&planar, &planarOut, kAGKPOPWarpTestsBufferMatrix, &options));
+        XCTAssertTrue(AGKPOPWarpBuffers(&biPlanar, &biPlanarOut, kAGKPOPWarpTestsBufferMatrix, &options));
+
+        size_t mismatches = 0;
+        for(size_t y = 0; y < 41; y++)
+        {
+            mismatches += memcmp(planarOut.planes[0].data + y * planarOut.planes[0].bytesPerRow,
+                                 biPlanarOut.planes[0].data + y * biPlanarOut.planes[0].bytesPerRow, 57) != 0;
+        }
+        for(size_t y = 0; y < 21; y++)
+        {
+            for(size_t x = 0; x < 29; x++)
+            {
+                const uint8_t *cbcr = biPlanarOut.planes[1].data + y * biPlanarOut.planes[1].bytesPerRow + x * 2;
+                mismatches += cbcr[0] != planarOut.planes[1].data[y * planarOut.planes[1].bytesPerRow + x];
+                mismatches += cbcr[1] != planarOut.planes[2].data[y * planarOut.planes[2].bytesPerRow + x];
+            }
+        }
+        XCTAssertEqual(mismatches, (size_t)0);
+    }
+
+    AGKPOPWarpTestsDestroyBuffer(&planar);
+    AGKPOPWarpTestsDestroyBuffer(&biPlanar);
+    AGKPOPWarpTestsDestroyBuffer(&planarOut);
+    AGKPOPWarpTestsDestroyBuffer(&biPlanarOut);
+}
+
+- (void)testBufferPixelsOutsideTheSourceAreNeutral
+{
+    // 20 luma pixels to the right, which is 10 chroma pixels
+    const double m[9] = {1.0, 0.0, 20.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0};
+    AGKPOPWarpBuffer source = AGKPOPWarpTestsCreateBuffer(AGKPOPWarpPixelFormatYUV420, 64, 48, 1);
+    AGKPOPWarpBuffer destination = AGKPOPWarpTestsCreateBuffer(AGKPOPWarpPixelFormatYUV420, 64, 48, 2);
+    AGKPOPWarpBuffer biPlanar = AGKPOPWarpTestsCreateBuffer(AGKPOPWarpPixelFormatYUV420BiPlanar, 64, 48, 3);
+    AGKPOPWarpBuffer biPlanarOut = AGKPOPWarpTestsCreateBuffer(AGKPOPWarpPixelFormatYUV420BiPlanar, 64, 48, 4);
+    XCTAssertTrue(AGKPOPWarpBuffers(&source, &destination, m, NULL));
+    XCTAssertTrue(AGKPOPWarpBuffers(&biPlanar, &biPlanarOut, m, NULL));
+
+    size_t wrong = 0;
+    for(size_t y = 0; y < 48; y++)
+    {
+        for(size_t x = 0; x < 64; x++)
+        {
+            const uint8_t *in = source.planes[0].data + y * source.planes[0].bytesPerRow;
+            uint8_t expected = x + 20 < 64 ? in[x + 20] : 0;
+            wrong += destination.planes[0].data[y * destination.planes[0].bytesPerRow + x] != expected;
+            wrong += biPlanarOut.planes[0].data[y * biPlanarOut.planes[0].bytesPerRow + x] != (x + 20 < 64 ? biPlanar.planes[0].data[y * biPlanar.planes[0].bytesPerRow + x + 20] : 0);
+        }
+    }
+    for(size_t y = 0; y < 24; y++)
+    {
+        for(size_t x = 0; x < 32; x++)
+        {
+            for(size_t plane = 1; plane < 3; plane++)
+            {
+                const uint8_t *in = source.planes[plane].data + y * source.planes[plane].bytesPerRow;
+                uint8_t expected = x + 10 < 32 ? in[x + 10] : 128;
+                wrong += destination.planes[plane].data[y * destination.planes[plane].bytesPerRow + x] != expected;
+            }
+            for(size_t c = 0; c < 2; c++)
+            {
+                const uint8_t *in = biPlanar.planes[1].data + y * biPlanar.planes[1].bytesPerRow;
+                uint8_t expected = x + 10 < 32 ? in[(x + 10) * 2 + c] : 128;
+                wrong += biPlanarOut.planes[1].data[y * biPlanarOut.planes[1].bytesPerRow + x * 2 + c] != expected;
+            }
+        }
+    }
+    XCTAssertEqual(wrong, (size_t)0);
+
+    AGKPOPWarpTestsDestroyBuffer(&source);
+    AGKPOPWarpTestsDestroyBuffer(&destination);
+    AGKPOPWarpTestsDestroyBuffer(&biPlanar);
+    AGKPOPWarpTestsDestroyBuffer(&biPlanarOut);
+}
+
+- (void)testMismatchedBufferFormatsAreRejected
+{
+    const double identity[9] = {1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0};
+    AGKPOPWarpBuffer source = AGKPOPWarpTestsCreateBuffer(AGKPOPWarpPixelFormatYUV420, 16, 16, 1);
+    AGKPOPWarpBuffer destination = AGKPOPWarpTestsCreateBuffer(AGKPOPWarpPixelFormatYUV420BiPlanar, 16, 16, 2);
+    AGKPOPWarpBuffer untouched = AGKPOPWarpTestsCreateBuffer(AGKPOPWarpPixelFormatYUV420BiPlanar, 16, 16, 2);
+
+    XCTAssertFalse(AGKPOPWarpBuffers(&source, &destination, identity, NULL));
+    XCTAssertEqual(memcmp(destination.planes[0].data, untouched.planes[0].data, destination.planes[0].bytesPerRow * 16), 0);
+    XCTAssertEqual(memcmp(destination.planes[1].data, untouched.planes[1].data, destination.planes[1].bytesPerRow * 8), 0);
+
+    AGKPOPWarpTestsDestroyBuffer(&source);
+    AGKPOPWarpTestsDestroyBuffer(&destination);
+    AGKPOPWarpTestsDestroyBuffer(&untouched);
+}
+
+- (void)testBilinearHalfwayBetweenPixelsAverages
+{
+    AGKPOPWarpBitmap source = AGKPOPWarpTestsCreateBitmap(32, 24, 1);
+    AGKPOPWarpBitmap destination = {malloc(32 * 24 * 4), 32, 24, 32 * 4};
+    AGKPOPWarpOptions options = {AGKPOPWarpFilterBilinear, false};
+
+    // Half a pixel right lands halfway between two pixel centers, half a
+    // pixel right and down in the middle of four
+    const double offsets[2][2] = {{0.5, 0.0}, {0.5, 0.5}};
+    for(int i = 0; i < 2; i++)
+    {
+        const double m[9] = {1.0, 0.0, offsets[i][0], 0.0, 1.0, offsets[i][1], 0.0, 0.0, 1.0};
+        AGKPOPWarp(&source, &destination, m, &options);
+
+        size_t wrong = 0;
+        size_t dy = offsets[i][1] > 0.0;
+        for(size_t y = 0; y + dy < 24; y++)
+        {
+            for(size_t x = 0; x + 1 < 32; x++)
+            {
+                for(size_t c = 0; c < 4; c++)
+                {
+                    const uint8_t *p0 = source.data + y * source.bytesPerRow + x * 4 + c;
+                    const uint8_t *p1 = p0 + dy * source.bytesPerRow;
+                    unsigned expected = dy ? (p0[0] + p0[4] + p1[0] + p1[4] + 2) / 4 : (p0[0] + p0[4] + 1) / 2;
+                    wrong += destination.data[y * destination.bytesPerRow + x * 4 + c] != expected;
+                }
+            }
+        }
+        XCTAssertEqual(wrong, (size_t)0);
+    }
+
+    free(source.data);
+    free(destination.data);
+}
+
+- (void)testBicubicMatchesCatmullRom
+{
+    // Every row is 10, 50, 200, 30, ..., so only the horizontal weights matter
+    uint8_t sourceData[8 * 4];
+    const uint8_t row[8] = {10, 50, 200, 30, 0, 0, 0, 0};
+    for(size_t y = 0; y < 4; y++)
+    {
+        memcpy(sourceData + y * 8, row, 8);
+    }
+    uint8_t destinationData[8 * 4];
+    AGKPOPWarpBuffer source = {AGKPOPWarpPixelFormatGray8, 8, 4, {{sourceData, 8}}};
+    AGKPOPWarpBuffer destination = {AGKPOPWarpPixelFormatGray8, 8, 4, {{destinationData, 8}}};
+
+    // Halfway between two pixels the Catmull-Rom weights are -1/16, 9/16, 9/16
+    // and -1/16. Between pixels 1 and 2 that is (-10 + 9 * 50 + 9 * 200 - 30) / 16 = 138.125
+    const double m[9] = {1.0, 0.0, 0.5, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0};
+    AGKPOPWarpOptions options = {AGKPOPWarpFilterBicubic, false};
+    XCTAssertTrue(AGKPOPWarpBuffers(&source, &destination, m, &options));
+    // and between pixels 2 and 3 (-50 + 9 * 200 + 9 * 30 - 0) / 16 = 126.25
+    for(size_t y = 0; y < 4; y++)
+    {
+        XCTAssertEqual(destinationData[y * 8 + 1], 138);
+        XCTAssertEqual(destinationData[y * 8 + 2], 126);
+    }
+}
+
+- (void)testMipmapsSampleTheBoxFilteredLevel
+{
+    AGKPOPWarpBitmap source = AGKPOPWarpTestsCreateBitmap(64, 64, 1);
+    AGKPOPWarpBitmap destination = {malloc(16 * 16 * 4), 16, 16, 16 * 4};
+
+    // Minified four times, the box filter applied twice
+    uint8_t half[32 * 32 * 4];
+    uint8_t quarter[16 * 16 * 4];
+    for(size_t i = 0; i < 32 * 32 * 4; i++)
+    {
+        size_t x = i / 4 % 32, y = i / 4 / 32, c = i % 4;
+        const uint8_t *p = source.data + 2 * y * source.bytesPerRow + 2 * x * 4 + c;
+        half[i] = (uint8_t)((p[0] + p[4] + p[source.bytesPerRow] + p[source.bytesPerRow + 4] + 2) >> 2);
+    }
+    for(size_t i = 0; i < 16 * 16 * 4; i++)
+    {
+        size_t x = i / 4 % 16, y = i / 4 / 16, c = i % 4;
+        const uint8_t *p = half + 2 * y * 32 * 4 + 2 * x * 4 + c;
+        quarter[i] = (uint8_t)((p[0] + p[4] + p[32 * 4] + p[32 * 4 + 4] + 2) >> 2);
+    }
+
+    // Every destination pixel lands on a pixel of that level. Sampled nearest,
+    // bilinear from the level above would land halfway between four of its
+    // pixels and give the same result.
+    const double m[9] = {4.0, 0.0, 0.0, 0.0, 4.0, 0.0, 0.0, 0.0, 1.0};
+    AGKPOPWarpOptions options = {AGKPOPWarpFilterNearest, true};
+    AGKPOPWarp(&source, &destination, m, &options);
+    XCTAssertEqual(memcmp(destination.data, quarter, sizeof(quarter)), 0);
+
+    // Without mipmaps it is every fourth source pixel
+    options.mipmaps = false;
+    AGKPOPWarp(&source, &destination, m, &options);
+    XCTAssertNotEqual(memcmp(destination.data, quarter, sizeof(quarter)), 0);
+
+    free(source.data);
+    free(destination.data);
+}
+
+@end
@@ -0,0 +1,247 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "AGKPOPBufferPool.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Smallest bucket is 4 KB, everything below is served from it
+#define kAGKPOPBufferPoolMinShift 12
+#define kAGKPOPBufferPoolBucketsPerShift 4
+#define kAGKPOPBufferPoolBucketCount (kAGKPOPBufferPoolBucketsPerShift * (sizeof(size_t) * 8 - kAGKPOPBufferPoolMinShift - 1))
+
+static const size_t kAGKPOPBufferPoolSharedMaxCachedBytes = 64 * 1024 * 1024;
+
+// In front of every buffer, sized so that the buffer stays aligned like malloc
+typedef union AGKPOPBufferPoolHeader {
+    struct {
+        union AGKPOPBufferPoolHeader *next;
+        size_t bucket;
+    } info;
+    long double alignment;
+} AGKPOPBufferPoolHeader;
+
+struct AGKPOPBufferPool {
+    pthread_mutex_t lock;
+    AGKPOPBufferPoolHeader *buckets[kAGKPOPBufferPoolBucketCount];
+    AGKPOPBufferPoolStatistics statistics;
+};
+
+static size_t AGKPOPBufferPoolBucketSize(size_t bucket)
+{
+    size_t shift = kAGKPOPBufferPoolMinShift + bucket / kAGKPOPBufferPoolBucketsPerShift;
+    size_t step = bucket % kAGKPOPBufferPoolBucketsPerShift;
+    return (kAGKPOPBufferPoolBucketsPerShift + step) << (shift - 2);
+}
+
+// Smallest bucket holding size bytes, or SIZE_MAX when there is none
+static size_t AGKPOPBufferPoolBucketForSize(size_t size)
+{
+    if(size <= ((size_t)1 << kAGKPOPBufferPoolMinShift))
+    {
+        return 0;
+    }
+    if(size > SIZE_MAX / 4)
+    {
+        return SIZE_MAX;
+    }
+
+    size_t shift = 0;
+    while((size >> (shift + 1)) != 0)
+    {
+        shift++;
+    }
+    size_t unit = (size_t)1 << (shift - 2);
+    size_t step = (size + unit - 1) / unit - kAGKPOPBufferPoolBucketsPerShift;
+    if(step == kAGKPOPBufferPoolBucketsPerShift)
+    {
+        shift++;
+        step = 0;
+    }
+    return (shift - kAGKPOPBufferPoolMinShift) * kAGKPOPBufferPoolBucketsPerShift + step;
+}
+
+AGKPOPBufferPool *AGKPOPBufferPoolCreate(size_t maxCachedBytes)
+{
+    AGKPOPBufferPool *pool = calloc(1, sizeof(AGKPOPBufferPool));
+    if(pool == NULL)
+    {
+        return NULL;
+    }
+    if(pthread_mutex_init(&pool->lock, NULL) != 0)
+    {
+        free(pool);
+        return NULL;
+    }
+    pool->statistics.maxCachedBytes = maxCachedBytes;
+    return pool;
+}
+
+void AGKPOPBufferPoolDestroy(AGKPOPBufferPool *pool)
+{
+    if(pool == NULL)
+    {
+        return;
+    }
+    AGKPOPBufferPoolPurge(pool);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+}
+
+static AGKPOPBufferPool *sharedPool;
+
+static void AGKPOPBufferPoolCreateShared(void)
+{
+    sharedPool = AGKPOPBufferPoolCreate(kAGKPOPBufferPoolSharedMaxCachedBytes);
+}
+
+AGKPOPBufferPool *AGKPOPBufferPoolShared(void)
+{
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, AGKPOPBufferPoolCreateShared);
+    return sharedPool;
+}
+
+void *AGKPOPBufferPoolAcquire(AGKPOPBufferPool *pool, size_t size)
+{
+    size_t bucket = AGKPOPBufferPoolBucketForSize(size);
+    if(bucket == SIZE_MAX)
+    {
+        return NULL;
+    }
+    size_t bucketSize = AGKPOPBufferPoolBucketSize(bucket);
+
+    // Without a pool, like when the shared one could not be created, every
+    // buffer is allocated and freed on its own
+    AGKPOPBufferPoolHeader *header = NULL;
+    if(pool)
+    {
+        pthread_mutex_lock(&pool->lock);
+        header = pool->buckets[bucket];
+        if(header)
+        {
+            pool->buckets[bucket] = header->info.next;
+            pool->statistics.cachedBytes -= bucketSize;
+            pool->statistics.hits++;
+        }
+        else
+        {
+            pool->statistics.misses++;
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    if(header == NULL)
+    {
+        header = malloc(sizeof(AGKPOPBufferPoolHeader) + bucketSize);
+        if(header == NULL)
+        {
+            return NULL;
+        }
+        header->info.bucket = bucket;
+    }
+    return header + 1;
+}
+
+void AGKPOPBufferPoolRelease(AGKPOPBufferPool *pool, void *buffer)
+{
+    if(buffer == NULL)
+    {
+        return;
+    }
+
+    AGKPOPBufferPoolHeader *header = (AGKPOPBufferPoolHeader *)buffer - 1;
+    if(pool == NULL)
+    {
+        free(header);
+        return;
+    }
+    size_t bucketSize = AGKPOPBufferPoolBucketSize(header->info.bucket);
+
+    pthread_mutex_lock(&pool->lock);
+    AGKPOPBufferPoolStatistics *statistics = &pool->statistics;
+    if(bucketSize <= statistics->maxCachedBytes && statistics->cachedBytes <= statistics->maxCachedBytes - bucketSize)
+    {
+        header->info.next = pool->buckets[header->info.bucket];
+        pool->buckets[header->info.bucket] = header;
+        statistics->cachedBytes += bucketSize;
+        header = NULL;
+    }
+    else
+    {
+        statistics->discards++;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    free(header);
+}
+
+// Frees released buffers, largest first, until at most maxCachedBytes are held.
+// Must be called with the lock held.
+static void AGKPOPBufferPoolEvict(AGKPOPBufferPool *pool, size_t maxCachedBytes)
+{
+    for(size_t bucket = kAGKPOPBufferPoolBucketCount; bucket-- > 0 && pool->statistics.cachedBytes > maxCachedBytes;)
+    {
+        size_t bucketSize = AGKPOPBufferPoolBucketSize(bucket);
+        while(pool->buckets[bucket] && pool->statistics.cachedBytes > maxCachedBytes)
+        {
+            AGKPOPBufferPoolHeader *header = pool->buckets[bucket];
+            pool->buckets[bucket] = header->info.next;
+            pool->statistics.cachedBytes -= bucketSize;
+            free(header);
+        }
+    }
+}
+
+void AGKPOPBufferPoolSetMaxCachedBytes(AGKPOPBufferPool *pool, size_t maxCachedBytes)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->statistics.maxCachedBytes = maxCachedBytes;
+    AGKPOPBufferPoolEvict(pool, maxCachedBytes);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void AGKPOPBufferPoolPurge(AGKPOPBufferPool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    AGKPOPBufferPoolEvict(pool, 0);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+AGKPOPBufferPoolStatistics AGKPOPBufferPoolGetStatistics(AGKPOPBufferPool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    AGKPOPBufferPoolStatistics statistics = pool->statistics;
+    pthread_mutex_unlock(&pool->lock);
+    return statistics;
+}
+
+void AGKPOPBufferPoolResetStatistics(AGKPOPBufferPool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->statistics.hits = 0;
+    pool->statistics.misses = 0;
+    pool->statistics.discards = 0;
+    pthread_mutex_unlock(&pool->lock);
+}
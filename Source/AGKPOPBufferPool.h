@@ -0,0 +1,84 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef AGKPOPBufferPool_h
+#define AGKPOPBufferPool_h
+
+#include <stddef.h>
+#include "AGKBaseDefines.h"
+
+AGK_EXTERN_C_BEGIN
+
+/*
+ Thread safe pool of large scratch buffers, so that warping a preview on every
+ frame does not allocate and free full size bitmaps every time. Sizes are
+ rounded up to one of four buckets per power of two (at most 25% waste) and
+ released buffers are kept per bucket for the next acquire of that size.
+
+ The pool holds at most maxCachedBytes of released buffers. A buffer released
+ beyond that is freed. Acquired buffers are not cleared.
+ */
+
+typedef struct AGKPOPBufferPool AGKPOPBufferPool;
+
+typedef struct AGKPOPBufferPoolStatistics {
+    size_t hits;         // acquires served from the pool
+    size_t misses;       // acquires that had to allocate
+    size_t discards;     // releases freed because the pool was full
+    size_t cachedBytes;  // held by released buffers right now
+    size_t maxCachedBytes;
+} AGKPOPBufferPoolStatistics;
+
+AGKPOPBufferPool *AGKPOPBufferPoolCreate(size_t maxCachedBytes);
+void AGKPOPBufferPoolDestroy(AGKPOPBufferPool *pool);
+
+/**
+ * @discussion
+ *   The pool used by the warp functions, holding at most 64 MB by default.
+ */
+AGKPOPBufferPool *AGKPOPBufferPoolShared(void);
+
+/**
+ * @discussion
+ *   Returns a buffer of at least size bytes, aligned like malloc, or NULL when
+ *   out of memory. Pass it back with AGKPOPBufferPoolRelease to the same pool.
+ *   A NULL pool, which AGKPOPBufferPoolShared returns when out of memory,
+ *   allocates and frees every buffer without caching it.
+ */
+void *AGKPOPBufferPoolAcquire(AGKPOPBufferPool *pool, size_t size);
+void AGKPOPBufferPoolRelease(AGKPOPBufferPool *pool, void *buffer);
+
+/**
+ * @discussion
+ *   Lowering the cap frees released buffers until the pool fits. Purge frees
+ *   all of them, for instance on a memory warning.
+ */
+void AGKPOPBufferPoolSetMaxCachedBytes(AGKPOPBufferPool *pool, size_t maxCachedBytes);
+void AGKPOPBufferPoolPurge(AGKPOPBufferPool *pool);
+
+AGKPOPBufferPoolStatistics AGKPOPBufferPoolGetStatistics(AGKPOPBufferPool *pool);
+void AGKPOPBufferPoolResetStatistics(AGKPOPBufferPool *pool);
+
+AGK_EXTERN_C_END
+
+#endif
@@ -0,0 +1,115 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "AGKPOPDecay.h"
+#include <math.h>
+
+const double kAGKPOPDecayDefaultDeceleration = 0.998;
+
+// See kPOPAnimationDecayMinimalVelocityFactor in POPDecayAnimationInternal.h
+static const double kAGKPOPDecayMinimalVelocityFactor = 5.0;
+
+double AGKPOPDecayDuration(const double *velocity, size_t count, double deceleration, double threshold)
+{
+    double minimal = threshold * kAGKPOPDecayMinimalVelocityFactor;
+    if(!(deceleration > 0.0 && deceleration < 1.0))
+    {
+        // With a deceleration of zero (or less) the velocity is gone after the
+        // first step. With 1 or more it never drops.
+        if(deceleration <= 0.0)
+        {
+            return 0.0;
+        }
+        for(size_t i = 0; i < count; i++)
+        {
+            if(fabs(velocity[i]) > minimal)
+            {
+                return INFINITY;
+            }
+        }
+        return 0.0;
+    }
+
+    double rate = log(deceleration) * 1000.0;
+    double duration = 0.0;
+    for(size_t i = 0; i < count; i++)
+    {
+        double speed = fabs(velocity[i]);
+        if(speed > minimal)
+        {
+            double t = log(minimal / speed) / rate;
+            if(t > duration)
+            {
+                duration = t;
+            }
+        }
+    }
+    return duration;
+}
+
+void AGKPOPDecayEvaluate(const double *from,
+                         const double *velocity,
+                         size_t count,
+                         double deceleration,
+                         double t,
+                         double *position,
+                         double *velocityOut)
+{
+    double kv = pow(deceleration, t * 1000.0);
+    double kx = deceleration == 1.0 ? t * 1000.0 : deceleration * (1.0 - kv) / (1.0 - deceleration);
+
+    for(size_t i = 0; i < count; i++)
+    {
+        double v0 = velocity[i];
+        if(position)
+        {
+            position[i] = from[i] + v0 / 1000.0 * kx;
+        }
+        if(velocityOut)
+        {
+            velocityOut[i] = v0 * kv;
+        }
+    }
+}
+
+double AGKPOPDecayProjectedValue(const double *from,
+                                 const double *velocity,
+                                 size_t count,
+                                 double deceleration,
+                                 double threshold,
+                                 double *to)
+{
+    double duration = AGKPOPDecayDuration(velocity, count, deceleration, threshold);
+    if(isinf(duration))
+    {
+        // Never stops, so every moving component ends up at infinity. Avoid
+        // evaluating 0 * inf for the ones standing still.
+        for(size_t i = 0; i < count; i++)
+        {
+            to[i] = velocity[i] == 0.0 ? from[i] : copysign(INFINITY, velocity[i]);
+        }
+        return duration;
+    }
+    AGKPOPDecayEvaluate(from, velocity, count, deceleration, duration, to, NULL);
+    return duration;
+}
@@ -0,0 +1,86 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef AGKPOPDecay_h
+#define AGKPOPDecay_h
+
+#include <stddef.h>
+#include "AGKBaseDefines.h"
+
+AGK_EXTERN_C_BEGIN
+
+/*
+ Closed form of the decay used by POPDecayAnimation. POP multiplies the velocity
+ by d for every millisecond, so after t seconds
+
+     v(t) = v0 * d^(1000 t)
+     p(t) = p0 + v0 / 1000 * d * (1 - d^(1000 t)) / (1 - d)
+
+ where d is the deceleration. Stepping this frame by frame gives the same
+ result as evaluating it once, so an animation can be sampled at any time, and
+ the time and value where POP would stop are known when it starts.
+
+ POP stops a decay when every component of the velocity is below five times
+ the threshold of the property.
+ */
+
+extern const double kAGKPOPDecayDefaultDeceleration;
+
+/**
+ * @discussion
+ *   Time until every component of the velocity is below 5 * threshold, the
+ *   `duration` of a POPDecayAnimation. Zero if it already is, INFINITY if the
+ *   deceleration is 1 or more and some component is above it, as the decay
+ *   then never stops.
+ */
+double AGKPOPDecayDuration(const double *velocity, size_t count, double deceleration, double threshold);
+
+/**
+ * @discussion
+ *   Position and velocity at time t. Either output may be NULL, position may
+ *   be the same array as from.
+ */
+void AGKPOPDecayEvaluate(const double *from,
+                         const double *velocity,
+                         size_t count,
+                         double deceleration,
+                         double t,
+                         double *position,
+                         double *velocityOut);
+
+/**
+ * @discussion
+ *   Where the decay stops, the `toValue` POP computes for a decay animation.
+ *   Returns the duration. When the decay never stops the moving components
+ *   are set to +/-INFINITY and the duration is INFINITY.
+ */
+double AGKPOPDecayProjectedValue(const double *from,
+                                 const double *velocity,
+                                 size_t count,
+                                 double deceleration,
+                                 double threshold,
+                                 double *to);
+
+AGK_EXTERN_C_END
+
+#endif
@@ -0,0 +1,270 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "AGKPOPHomography.h"
+#include "AGKPOPMatrix.h"
+#include <math.h>
+#include <string.h>
+
+static bool AGKPOPHomographyNormalize(double h[9])
+{
+    if(h[8] == 0.0)
+    {
+        return false;
+    }
+
+    double inv = 1.0 / h[8];
+    for(int i = 0; i < 8; i++)
+    {
+        h[i] *= inv;
+    }
+    h[8] = 1.0;
+    return true;
+}
+
+// Rect to unit square is a scale and a translation, fold it into the columns
+static void AGKPOPHomographyFoldRect(double r[9], double x, double y, double sx, double sy)
+{
+    for(int row = 0; row < 3; row++)
+    {
+        double *m = r + row * 3;
+        m[2] -= m[0] * x * sx + m[1] * y * sy;
+        m[0] *= sx;
+        m[1] *= sy;
+    }
+}
+
+bool AGKPOPHomographySquareToQuad(const double quad[8], double out[9])
+{
+    double x0 = quad[0], y0 = quad[1];
+    double x1 = quad[2], y1 = quad[3];
+    double x2 = quad[4], y2 = quad[5];
+    double x3 = quad[6], y3 = quad[7];
+
+    double sx = x0 - x1 + x2 - x3;
+    double sy = y0 - y1 + y2 - y3;
+    double g = 0.0;
+    double h = 0.0;
+
+    if(sx != 0.0 || sy != 0.0)
+    {
+        double dx1 = x1 - x2;
+        double dx2 = x3 - x2;
+        double dy1 = y1 - y2;
+        double dy2 = y3 - y2;
+        double den = dx1 * dy2 - dx2 * dy1;
+        if(den == 0.0)
+        {
+            return false;
+        }
+        g = (sx * dy2 - dx2 * sy) / den;
+        h = (dx1 * sy - sx * dy1) / den;
+    }
+
+    double r[9] = {
+        x1 - x0 + g * x1, x3 - x0 + h * x3, x0,
+        y1 - y0 + g * y1, y3 - y0 + h * y3, y0,
+        g, h, 1.0,
+    };
+    if(AGKPOPMatrix3x3Determinant(r) == 0.0)
+    {
+        return false;
+    }
+    memcpy(out, r, sizeof(r));
+    return true;
+}
+
+bool AGKPOPHomographyRectToQuad(double x, double y, double width, double height, const double quad[8], double out[9])
+{
+    if(width == 0.0 || height == 0.0)
+    {
+        return false;
+    }
+
+    double r[9];
+    if(!AGKPOPHomographySquareToQuad(quad, r))
+    {
+        return false;
+    }
+
+    AGKPOPHomographyFoldRect(r, x, y, 1.0 / width, 1.0 / height);
+    if(!AGKPOPHomographyNormalize(r))
+    {
+        return false;
+    }
+    memcpy(out, r, sizeof(r));
+    return true;
+}
+
+bool AGKPOPHomographyQuadToQuad(const double from[8], const double to[8], double out[9])
+{
+    double fromSquare[9];
+    double toSquare[9];
+    double r[9];
+    if(!AGKPOPHomographySquareToQuad(from, fromSquare) ||
+       !AGKPOPHomographySquareToQuad(to, toSquare) ||
+       !AGKPOPMatrix3x3Invert(fromSquare, fromSquare))
+    {
+        return false;
+    }
+
+    AGKPOPMatrix3x3Multiply(toSquare, fromSquare, r);
+    if(!AGKPOPHomographyNormalize(r))
+    {
+        return false;
+    }
+    memcpy(out, r, sizeof(r));
+    return true;
+}
+
+// Below this ratio between the determinants of the new and the old basis the
+// rank one update loses too many digits and the basis is inverted again
+static double const kAGKPOPHomographyMinUpdateRatio = 1e-6;
+
+static bool AGKPOPHomographyStateInvertBasis(AGKPOPHomographyState *state)
+{
+    const double *q = state->quad;
+    double basis[9] = {
+        q[2], q[6], -q[0],
+        q[3], q[7], -q[1],
+        1.0,  1.0,  -1.0,
+    };
+    if(!AGKPOPMatrix3x3Invert(basis, state->basisInverse))
+    {
+        return false;
+    }
+    state->updates = 0;
+    return true;
+}
+
+static bool AGKPOPHomographyStateCompose(AGKPOPHomographyState *state)
+{
+    const double *q = state->quad;
+    const double *m = state->basisInverse;
+    double b = m[0] * q[4] + m[1] * q[5] + m[2];
+    double d = m[3] * q[4] + m[4] * q[5] + m[5];
+    double a = m[6] * q[4] + m[7] * q[5] + m[8];
+    if(a == 0.0 || b == 0.0 || d == 0.0)
+    {
+        return false;
+    }
+
+    double r[9] = {
+        b * q[2] - a * q[0], d * q[6] - a * q[0], a * q[0],
+        b * q[3] - a * q[1], d * q[7] - a * q[1], a * q[1],
+        b - a,               d - a,               a,
+    };
+    AGKPOPHomographyFoldRect(r, state->rect[0], state->rect[1], state->rect[2], state->rect[3]);
+    if(!AGKPOPHomographyNormalize(r))
+    {
+        return false;
+    }
+    memcpy(state->h, r, sizeof(r));
+    return true;
+}
+
+bool AGKPOPHomographyStateInit(AGKPOPHomographyState *state, double x, double y, double width, double height, const double quad[8])
+{
+    if(width == 0.0 || height == 0.0)
+    {
+        return false;
+    }
+
+    AGKPOPHomographyState s;
+    memcpy(s.quad, quad, sizeof(s.quad));
+    s.rect[0] = x;
+    s.rect[1] = y;
+    s.rect[2] = 1.0 / width;
+    s.rect[3] = 1.0 / height;
+    if(!AGKPOPHomographyStateInvertBasis(&s) || !AGKPOPHomographyStateCompose(&s))
+    {
+        return false;
+    }
+    *state = s;
+    return true;
+}
+
+bool AGKPOPHomographyStateMoveCorner(AGKPOPHomographyState *state, int corner, double dx, double dy)
+{
+    if(corner < 0 || corner > 3)
+    {
+        return false;
+    }
+
+    AGKPOPHomographyState s = *state;
+    s.quad[corner * 2] += dx;
+    s.quad[corner * 2 + 1] += dy;
+
+    // br is the right hand side, the others are column 0 (tr), 1 (bl) or 2 (-tl) of the basis
+    static const int columns[4] = {2, 0, -1, 1};
+    int k = columns[corner];
+    bool inverted = false;
+    if(k >= 0 && ++s.updates >= kAGKPOPHomographyMaxCornerUpdates)
+    {
+        inverted = AGKPOPHomographyStateInvertBasis(&s);
+        if(!inverted)
+        {
+            return false;
+        }
+    }
+
+    if(k >= 0 && !inverted)
+    {
+        // The column changes by u = (dx, dy, 0), negated for tl
+        double ux = k == 2 ? -dx : dx;
+        double uy = k == 2 ? -dy : dy;
+        double *m = s.basisInverse;
+        double w[3] = {
+            m[0] * ux + m[1] * uy,
+            m[3] * ux + m[4] * uy,
+            m[6] * ux + m[7] * uy,
+        };
+        double ratio = 1.0 + w[k];
+        if(fabs(ratio) < kAGKPOPHomographyMinUpdateRatio)
+        {
+            if(!AGKPOPHomographyStateInvertBasis(&s))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            double inv = 1.0 / ratio;
+            double row[3] = {m[k * 3] * inv, m[k * 3 + 1] * inv, m[k * 3 + 2] * inv};
+            for(int i = 0; i < 3; i++)
+            {
+                for(int j = 0; j < 3; j++)
+                {
+                    m[i * 3 + j] -= w[i] * row[j];
+                }
+            }
+        }
+    }
+
+    if(!AGKPOPHomographyStateCompose(&s))
+    {
+        return false;
+    }
+    *state = s;
+    return true;
+}
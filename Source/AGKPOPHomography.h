@@ -0,0 +1,86 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef AGKPOPHomography_h
+#define AGKPOPHomography_h
+
+#include <stdbool.h>
+#include "AGKBaseDefines.h"
+
+AGK_EXTERN_C_BEGIN
+
+/*
+ Closed form homographies between quadrilaterals, without building and solving
+ the general 8x8 system. Quads are passed as 8 doubles in the order
+ tl.x, tl.y, tr.x, tr.y, br.x, br.y, bl.x, bl.y. The result is a row-major 3x3
+ matrix h normalized so that h[8] = 1, mapping (x, y) to
+
+     x' = (h[0] * x + h[1] * y + h[2]) / (h[6] * x + h[7] * y + h[8])
+     y' = (h[3] * x + h[4] * y + h[5]) / (h[6] * x + h[7] * y + h[8])
+
+ The square to quad mapping is the one from Heckbert, "Fundamentals of Texture
+ Mapping and Image Warping" (1989). Quad to quad is composed as the square to
+ quad mapping of the destination after the inverse of the one of the source.
+
+ All functions return false when a quad is degenerate (three corners on a
+ line) and leave out untouched.
+ */
+
+bool AGKPOPHomographySquareToQuad(const double quad[8], double out[9]);
+bool AGKPOPHomographyRectToQuad(double x, double y, double width, double height, const double quad[8], double out[9]);
+bool AGKPOPHomographyQuadToQuad(const double from[8], const double to[8], double out[9]);
+
+/*
+ Rect to quad homography that is kept up to date while single corners move,
+ like when a corner is dragged. With the corners as homogeneous points P0..P3
+ the square to quad mapping is
+
+     H = [b * P1 - a * P0, d * P3 - a * P0, a * P0]   where   [P1 P3 -P0] (b, d, a) = P2
+
+ Moving tr, bl or tl replaces one column of that 3x3 basis, so its inverse is
+ updated with Sherman-Morrison instead of being solved again, and moving br only
+ changes the right hand side. When the update is ill-conditioned, or after
+ kAGKPOPHomographyMaxCornerUpdates updates to bound the accumulated rounding
+ error, the basis is inverted from scratch instead.
+
+ h holds the current solution in the same form as AGKPOPHomographyRectToQuad.
+ The functions return false when the quad becomes degenerate and then leave the
+ state untouched.
+ */
+
+#define kAGKPOPHomographyMaxCornerUpdates 64
+
+typedef struct AGKPOPHomographyState {
+    double h[9];
+    double quad[8];
+    double rect[4]; // x, y, 1 / width, 1 / height
+    double basisInverse[9];
+    unsigned int updates;
+} AGKPOPHomographyState;
+
+bool AGKPOPHomographyStateInit(AGKPOPHomographyState *state, double x, double y, double width, double height, const double quad[8]);
+bool AGKPOPHomographyStateMoveCorner(AGKPOPHomographyState *state, int corner, double dx, double dy);
+
+AGK_EXTERN_C_END
+
+#endif
@@ -0,0 +1,417 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "AGKPOPMatrix.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+void AGKPOPMatrix3x3Multiply(const double a[9], const double b[9], double out[9])
+{
+    double r[9];
+    for(int row = 0; row < 3; row++)
+    {
+        for(int col = 0; col < 3; col++)
+        {
+            r[row * 3 + col] = a[row * 3 + 0] * b[0 * 3 + col]
+                             + a[row * 3 + 1] * b[1 * 3 + col]
+                             + a[row * 3 + 2] * b[2 * 3 + col];
+        }
+    }
+    memcpy(out, r, sizeof(r));
+}
+
+double AGKPOPMatrix3x3Determinant(const double m[9])
+{
+    return m[0] * (m[4] * m[8] - m[5] * m[7])
+         + m[1] * (m[5] * m[6] - m[3] * m[8])
+         + m[2] * (m[3] * m[7] - m[4] * m[6]);
+}
+
+bool AGKPOPMatrix3x3Invert(const double m[9], double out[9])
+{
+    double a = m[4] * m[8] - m[5] * m[7];
+    double b = m[5] * m[6] - m[3] * m[8];
+    double c = m[3] * m[7] - m[4] * m[6];
+    double det = m[0] * a + m[1] * b + m[2] * c;
+    if(det == 0.0)
+    {
+        return false;
+    }
+
+    double inv = 1.0 / det;
+    double r[9];
+    r[0] = a * inv;
+    r[1] = (m[2] * m[7] - m[1] * m[8]) * inv;
+    r[2] = (m[1] * m[5] - m[2] * m[4]) * inv;
+    r[3] = b * inv;
+    r[4] = (m[0] * m[8] - m[2] * m[6]) * inv;
+    r[5] = (m[2] * m[3] - m[0] * m[5]) * inv;
+    r[6] = c * inv;
+    r[7] = (m[1] * m[6] - m[0] * m[7]) * inv;
+    r[8] = (m[0] * m[4] - m[1] * m[3]) * inv;
+    memcpy(out, r, sizeof(r));
+    return true;
+}
+
+void AGKPOPMatrixTranspose(const double *m, size_t rows, size_t cols, double *out)
+{
+    if(m == out)
+    {
+        // Square, swap in place
+        for(size_t row = 0; row < rows; row++)
+        {
+            for(size_t col = row + 1; col < cols; col++)
+            {
+                double value = out[row * cols + col];
+                out[row * cols + col] = out[col * cols + row];
+                out[col * cols + row] = value;
+            }
+        }
+        return;
+    }
+
+    for(size_t row = 0; row < rows; row++)
+    {
+        for(size_t col = 0; col < cols; col++)
+        {
+            out[col * rows + row] = m[row * cols + col];
+        }
+    }
+}
+
+void AGKPOPMatrixMultiply(const double *a, const double *b, size_t rows, size_t inner, size_t cols, double *out)
+{
+    for(size_t row = 0; row < rows; row++)
+    {
+        double *r = out + row * cols;
+        for(size_t col = 0; col < cols; col++)
+        {
+            r[col] = 0.0;
+        }
+        for(size_t i = 0; i < inner; i++)
+        {
+            double value = a[row * inner + i];
+            const double *bRow = b + i * cols;
+            for(size_t col = 0; col < cols; col++)
+            {
+                r[col] += value * bRow[col];
+            }
+        }
+    }
+}
+
+static double *AGKPOPMatrixScratch(double *stack, size_t count)
+{
+    if(count <= kAGKPOPMatrixMaxStackDimension * kAGKPOPMatrixMaxStackDimension)
+    {
+        return stack;
+    }
+    return malloc(count * sizeof(double));
+}
+
+static void AGKPOPMatrixScratchFree(double *stack, double *scratch)
+{
+    if(scratch != stack)
+    {
+        free(scratch);
+    }
+}
+
+static size_t AGKPOPMatrixPivot(const double *m, size_t n, size_t cols, size_t col)
+{
+    size_t pivot = col;
+    double best = fabs(m[col * cols + col]);
+    for(size_t row = col + 1; row < n; row++)
+    {
+        double value = fabs(m[row * cols + col]);
+        if(value > best)
+        {
+            best = value;
+            pivot = row;
+        }
+    }
+    return pivot;
+}
+
+static void AGKPOPMatrixSwapRows(double *m, size_t cols, size_t i, size_t k)
+{
+    for(size_t col = 0; col < cols; col++)
+    {
+        double value = m[i * cols + col];
+        m[i * cols + col] = m[k * cols + col];
+        m[k * cols + col] = value;
+    }
+}
+
+// Determinant by LU decomposition, overwriting lu
+static double AGKPOPMatrixDeterminantInPlace(double *lu, size_t n)
+{
+    double det = 1.0;
+    for(size_t col = 0; col < n; col++)
+    {
+        size_t pivot = AGKPOPMatrixPivot(lu, n, n, col);
+        if(lu[pivot * n + col] == 0.0)
+        {
+            det = 0.0;
+            break;
+        }
+        if(pivot != col)
+        {
+            AGKPOPMatrixSwapRows(lu, n, pivot, col);
+            det = -det;
+        }
+
+        double diagonal = lu[col * n + col];
+        det *= diagonal;
+        for(size_t row = col + 1; row < n; row++)
+        {
+            double factor = lu[row * n + col] / diagonal;
+            for(size_t k = col + 1; k < n; k++)
+            {
+                lu[row * n + k] -= factor * lu[col * n + k];
+            }
+        }
+    }
+    return det;
+}
+
+double AGKPOPMatrixDeterminant(const double *m, size_t n)
+{
+    if(n == 0)
+    {
+        return 1.0;
+    }
+    if(n == 3)
+    {
+        return AGKPOPMatrix3x3Determinant(m);
+    }
+
+    double stack[kAGKPOPMatrixMaxStackDimension * kAGKPOPMatrixMaxStackDimension];
+    double *lu = AGKPOPMatrixScratch(stack, n * n);
+    if(lu == NULL)
+    {
+        return NAN;
+    }
+    memcpy(lu, m, n * n * sizeof(double));
+
+    double det = AGKPOPMatrixDeterminantInPlace(lu, n);
+    AGKPOPMatrixScratchFree(stack, lu);
+    return det;
+}
+
+// Reduces the augmented matrix [a | x] (n x (n + extra)) so that the left part
+// becomes the identity and the right part holds the solution.
+static bool AGKPOPMatrixGaussJordan(double *a, size_t n, size_t extra)
+{
+    size_t cols = n + extra;
+    for(size_t col = 0; col < n; col++)
+    {
+        size_t pivot = AGKPOPMatrixPivot(a, n, cols, col);
+        if(a[pivot * cols + col] == 0.0)
+        {
+            return false;
+        }
+        if(pivot != col)
+        {
+            AGKPOPMatrixSwapRows(a, cols, pivot, col);
+        }
+
+        double inv = 1.0 / a[col * cols + col];
+        for(size_t k = col; k < cols; k++)
+        {
+            a[col * cols + k] *= inv;
+        }
+
+        for(size_t row = 0; row < n; row++)
+        {
+            double factor = a[row * cols + col];
+            if(row == col || factor == 0.0)
+            {
+                continue;
+            }
+            for(size_t k = col; k < cols; k++)
+            {
+                a[row * cols + k] -= factor * a[col * cols + k];
+            }
+        }
+    }
+    return true;
+}
+
+bool AGKPOPMatrixInvert(const double *m, size_t n, double *out)
+{
+    if(n == 3)
+    {
+        return AGKPOPMatrix3x3Invert(m, out);
+    }
+
+    double stack[2 * kAGKPOPMatrixMaxStackDimension * kAGKPOPMatrixMaxStackDimension];
+    double *a = 2 * n * n <= sizeof(stack) / sizeof(stack[0]) ? stack : malloc(2 * n * n * sizeof(double));
+    if(a == NULL)
+    {
+        return false;
+    }
+
+    size_t cols = 2 * n;
+    for(size_t row = 0; row < n; row++)
+    {
+        memcpy(a + row * cols, m + row * n, n * sizeof(double));
+        for(size_t col = 0; col < n; col++)
+        {
+            a[row * cols + n + col] = row == col ? 1.0 : 0.0;
+        }
+    }
+
+    bool success = AGKPOPMatrixGaussJordan(a, n, n);
+    if(success)
+    {
+        for(size_t row = 0; row < n; row++)
+        {
+            memcpy(out + row * n, a + row * cols + n, n * sizeof(double));
+        }
+    }
+
+    AGKPOPMatrixScratchFree(stack, a);
+    return success;
+}
+
+bool AGKPOPMatrixSolve(const double *m, const double *b, size_t n, double *x)
+{
+    double stack[kAGKPOPMatrixMaxStackDimension * (kAGKPOPMatrixMaxStackDimension + 1)];
+    double *a = n * (n + 1) <= sizeof(stack) / sizeof(stack[0]) ? stack : malloc(n * (n + 1) * sizeof(double));
+    if(a == NULL)
+    {
+        return false;
+    }
+
+    size_t cols = n + 1;
+    for(size_t row = 0; row < n; row++)
+    {
+        memcpy(a + row * cols, m + row * n, n * sizeof(double));
+        a[row * cols + n] = b[row];
+    }
+
+    bool success = AGKPOPMatrixGaussJordan(a, n, 1);
+    if(success)
+    {
+        for(size_t row = 0; row < n; row++)
+        {
+            x[row] = a[row * cols + n];
+        }
+    }
+
+    AGKPOPMatrixScratchFree(stack, a);
+    return success;
+}
+
+bool AGKPOPMatrixCofactor(const double *m, size_t n, double *out)
+{
+    if(n == 1)
+    {
+        out[0] = 1.0;
+        return true;
+    }
+
+    double minorStack[kAGKPOPMatrixMaxStackDimension * kAGKPOPMatrixMaxStackDimension];
+    double resultStack[kAGKPOPMatrixMaxStackDimension * kAGKPOPMatrixMaxStackDimension];
+    double *minor = AGKPOPMatrixScratch(minorStack, (n - 1) * (n - 1));
+    double *result = AGKPOPMatrixScratch(resultStack, n * n);
+    if(minor == NULL || result == NULL)
+    {
+        AGKPOPMatrixScratchFree(minorStack, minor);
+        AGKPOPMatrixScratchFree(resultStack, result);
+        return false;
+    }
+
+    for(size_t i = 0; i < n; i++)
+    {
+        for(size_t j = 0; j < n; j++)
+        {
+            double *cursor = minor;
+            for(size_t row = 0; row < n; row++)
+            {
+                if(row == i)
+                {
+                    continue;
+                }
+                for(size_t col = 0; col < n; col++)
+                {
+                    if(col != j)
+                    {
+                        *cursor++ = m[row * n + col];
+                    }
+                }
+            }
+
+            // The minor is rebuilt for every element, so it can be decomposed
+            // in place instead of being copied into more scratch memory
+            double value = AGKPOPMatrixDeterminantInPlace(minor, n - 1);
+            result[i * n + j] = (i + j) % 2 == 0 ? value : -value;
+        }
+    }
+
+    memcpy(out, result, n * n * sizeof(double));
+    AGKPOPMatrixScratchFree(minorStack, minor);
+    AGKPOPMatrixScratchFree(resultStack, result);
+    return true;
+}
+
+void AGKPOPMatrixGivens(double a, double b, double *c, double *s)
+{
+    if(b == 0.0)
+    {
+        *c = 1.0;
+        *s = 0.0;
+        return;
+    }
+
+    double r = hypot(a, b);
+    *c = a / r;
+    *s = b / r;
+}
+
+void AGKPOPMatrixRotateRows(double *m, size_t cols, size_t i, size_t k, double c, double s)
+{
+    double *rowI = m + i * cols;
+    double *rowK = m + k * cols;
+    for(size_t col = 0; col < cols; col++)
+    {
+        double a = rowI[col];
+        double b = rowK[col];
+        rowI[col] = c * a + s * b;
+        rowK[col] = -s * a + c * b;
+    }
+}
+
+void AGKPOPMatrixRotateColumns(double *m, size_t rows, size_t cols, size_t i, size_t k, double c, double s)
+{
+    for(size_t row = 0; row < rows; row++)
+    {
+        double *r = m + row * cols;
+        double a = r[i];
+        double b = r[k];
+        r[i] = c * a + s * b;
+        r[k] = -s * a + c * b;
+    }
+}
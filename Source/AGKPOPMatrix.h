@@ -0,0 +1,109 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef AGKPOPMatrix_h
+#define AGKPOPMatrix_h
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "AGKBaseDefines.h"
+
+AGK_EXTERN_C_BEGIN
+
+/*
+ Unboxed matrix math on plain row-major double arrays, element (row, col) of a
+ matrix with `cols` columns is at m[row * cols + col].
+
+ The functions taking a dimension work on any size and are used for the 4x4
+ and 8x8 cases. They only allocate when n is larger than
+ kAGKPOPMatrixMaxStackDimension. The 3x3 functions are unrolled, all of them
+ accept the same array as input and output.
+ */
+
+#define kAGKPOPMatrixMaxStackDimension 8
+
+void AGKPOPMatrix3x3Multiply(const double a[9], const double b[9], double out[9]);
+double AGKPOPMatrix3x3Determinant(const double m[9]);
+bool AGKPOPMatrix3x3Invert(const double m[9], double out[9]);
+
+/**
+ * @discussion
+ *   Transposes a rows x cols matrix into a cols x rows matrix. The output may
+ *   alias the input only when the matrix is square.
+ */
+void AGKPOPMatrixTranspose(const double *m, size_t rows, size_t cols, double *out);
+
+/**
+ * @discussion
+ *   out (rows x cols) = a (rows x inner) * b (inner x cols). The output may not
+ *   alias any of the inputs.
+ */
+void AGKPOPMatrixMultiply(const double *a, const double *b, size_t rows, size_t inner, size_t cols, double *out);
+
+double AGKPOPMatrixDeterminant(const double *m, size_t n);
+
+/**
+ * @discussion
+ *   Gauss-Jordan elimination with partial pivoting. Returns false and leaves
+ *   out untouched when the matrix is singular.
+ */
+bool AGKPOPMatrixInvert(const double *m, size_t n, double *out);
+
+/**
+ * @discussion
+ *   Solves m * x = b with Gaussian elimination and partial pivoting. b and x
+ *   may be the same array. Returns false when the matrix is singular.
+ */
+bool AGKPOPMatrixSolve(const double *m, const double *b, size_t n, double *x);
+
+/**
+ * @discussion
+ *   The matrix of cofactors, out[i][j] = (-1)^(i+j) * minor(i, j). The
+ *   adjugate is its transpose. Returns false and leaves out untouched when
+ *   scratch memory for a large matrix can't be allocated.
+ */
+bool AGKPOPMatrixCofactor(const double *m, size_t n, double *out);
+
+/**
+ * @discussion
+ *   Computes c and s so that the rotation G = [c s; -s c] gives
+ *   G * [a; b] = [r; 0].
+ */
+void AGKPOPMatrixGivens(double a, double b, double *c, double *s);
+
+/**
+ * @discussion
+ *   Multiplies row i and k of a matrix with `cols` columns by G from the left.
+ */
+void AGKPOPMatrixRotateRows(double *m, size_t cols, size_t i, size_t k, double c, double s);
+
+/**
+ * @discussion
+ *   Multiplies column i and k of a rows x cols matrix by the transpose of G
+ *   from the right.
+ */
+void AGKPOPMatrixRotateColumns(double *m, size_t rows, size_t cols, size_t i, size_t k, double c, double s);
+
+AGK_EXTERN_C_END
+
+#endif
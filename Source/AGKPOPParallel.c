@@ -0,0 +1,191 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "AGKPOPParallel.h"
+
+#if defined(__APPLE__)
+#include <dispatch/dispatch.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#if defined(__APPLE__)
+
+void AGKPOPParallelApply(size_t iterations, void *context, AGKPOPParallelWork work)
+{
+    if(iterations < 2)
+    {
+        if(iterations == 1)
+        {
+            work(context, 0);
+        }
+        return;
+    }
+    dispatch_apply_f(iterations, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), context, work);
+}
+
+#else
+
+// Workers are started on first use and kept for the life of the process. The
+// caller and the workers take iterations from a shared counter, so a slow
+// iteration does not hold up the others. One job runs at a time. A call made
+// while another one runs, like from inside a work function, runs serially.
+
+enum { kAGKPOPParallelMaxWorkers = 63 };
+
+typedef struct AGKPOPParallelJob {
+    size_t iterations;
+    void *context;
+    AGKPOPParallelWork work;
+    size_t next; // next iteration to take, updated atomically
+} AGKPOPParallelJob;
+
+static struct {
+    pthread_mutex_t submitLock; // held by the caller for the whole job
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    AGKPOPParallelJob *job;
+    unsigned long generation;
+    size_t active; // workers not yet done with the current job
+    size_t workerCount;
+} AGKPOPParallelPool = {
+    PTHREAD_MUTEX_INITIALIZER,
+    PTHREAD_MUTEX_INITIALIZER,
+    PTHREAD_COND_INITIALIZER,
+    PTHREAD_COND_INITIALIZER,
+    NULL, 0, 0, 0
+};
+
+static void AGKPOPParallelRun(AGKPOPParallelJob *job)
+{
+    for(;;)
+    {
+        size_t iteration = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED);
+        if(iteration >= job->iterations)
+        {
+            return;
+        }
+        job->work(job->context, iteration);
+    }
+}
+
+static void *AGKPOPParallelWorker(void *unused)
+{
+    (void)unused;
+    unsigned long generation = 0;
+
+    pthread_mutex_lock(&AGKPOPParallelPool.lock);
+    for(;;)
+    {
+        while(AGKPOPParallelPool.generation == generation)
+        {
+            pthread_cond_wait(&AGKPOPParallelPool.start, &AGKPOPParallelPool.lock);
+        }
+        generation = AGKPOPParallelPool.generation;
+        AGKPOPParallelJob *job = AGKPOPParallelPool.job;
+        pthread_mutex_unlock(&AGKPOPParallelPool.lock);
+
+        AGKPOPParallelRun(job);
+
+        pthread_mutex_lock(&AGKPOPParallelPool.lock);
+        if(--AGKPOPParallelPool.active == 0)
+        {
+            pthread_cond_signal(&AGKPOPParallelPool.done);
+        }
+    }
+    return NULL;
+}
+
+static void AGKPOPParallelStartWorkers(void)
+{
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t workerCount = cores > 1 ? (size_t)cores - 1 : 0;
+    if(workerCount > kAGKPOPParallelMaxWorkers)
+    {
+        workerCount = kAGKPOPParallelMaxWorkers;
+    }
+
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+    size_t started = 0;
+    for(; started < workerCount; started++)
+    {
+        pthread_t thread;
+        if(pthread_create(&thread, &attributes, AGKPOPParallelWorker, NULL) != 0)
+        {
+            break;
+        }
+    }
+    pthread_attr_destroy(&attributes);
+
+    AGKPOPParallelPool.workerCount = started;
+}
+
+void AGKPOPParallelApply(size_t iterations, void *context, AGKPOPParallelWork work)
+{
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+    AGKPOPParallelJob job;
+    job.iterations = iterations;
+    job.context = context;
+    job.work = work;
+    job.next = 0;
+
+    if(iterations < 2)
+    {
+        AGKPOPParallelRun(&job);
+        return;
+    }
+
+    pthread_once(&once, AGKPOPParallelStartWorkers);
+    if(AGKPOPParallelPool.workerCount == 0 || pthread_mutex_trylock(&AGKPOPParallelPool.submitLock) != 0)
+    {
+        AGKPOPParallelRun(&job);
+        return;
+    }
+
+    pthread_mutex_lock(&AGKPOPParallelPool.lock);
+    AGKPOPParallelPool.job = &job;
+    AGKPOPParallelPool.active = AGKPOPParallelPool.workerCount;
+    AGKPOPParallelPool.generation++;
+    pthread_cond_broadcast(&AGKPOPParallelPool.start);
+    pthread_mutex_unlock(&AGKPOPParallelPool.lock);
+
+    AGKPOPParallelRun(&job);
+
+    // Every worker has to be done with the job before it goes out of scope
+    pthread_mutex_lock(&AGKPOPParallelPool.lock);
+    while(AGKPOPParallelPool.active > 0)
+    {
+        pthread_cond_wait(&AGKPOPParallelPool.done, &AGKPOPParallelPool.lock);
+    }
+    AGKPOPParallelPool.job = NULL;
+    pthread_mutex_unlock(&AGKPOPParallelPool.lock);
+
+    pthread_mutex_unlock(&AGKPOPParallelPool.submitLock);
+}
+
+#endif
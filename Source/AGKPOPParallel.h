@@ -0,0 +1,47 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef AGKPOPParallel_h
+#define AGKPOPParallel_h
+
+#include <stddef.h>
+#include "AGKBaseDefines.h"
+
+AGK_EXTERN_C_BEGIN
+
+typedef void (*AGKPOPParallelWork)(void *context, size_t iteration);
+
+/**
+ * @discussion
+ *   Calls work once for every iteration in [0, iterations), spread over all
+ *   cores, and returns when all of them are done. Uses dispatch_apply_f on
+ *   Apple platforms and a pool of persistent worker threads elsewhere. A single
+ *   iteration, or a call made while the pool is busy, runs on the calling
+ *   thread. Iterations may run in any order, so they must not depend on each
+ *   other.
+ */
+void AGKPOPParallelApply(size_t iterations, void *context, AGKPOPParallelWork work);
+
+AGK_EXTERN_C_END
+
+#endif
@@ -0,0 +1,57 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <QuartzCore/QuartzCore.h>
+#import "AGKQuad.h"
+
+/**
+ * @discussion
+ *   The corner properties only animate a part of the quadrilateral, so with four
+ *   corner springs running every frame used to read, solve and write the
+ *   transform four times. Writes are instead buffered per layer and applied once
+ *   after POPAnimator has advanced all animations for the frame.
+ *
+ *   Reads made before the flush return the buffered quadrilateral so that the
+ *   corner properties see each others changes within the same frame.
+ */
+AGKQuad AGKPOPQuadCoalescerRead(CALayer *layer);
+void AGKPOPQuadCoalescerWrite(CALayer *layer, AGKQuad quad);
+
+/**
+ * @discussion
+ *   The last written or read quadrilateral is cached on the layer and returned
+ *   by `AGKPOPQuadCoalescerRead` as long as transform, bounds, position and the
+ *   superlayer are unchanged. Deriving the quadrilateral from the transform
+ *   means projecting all four corners, so reads are otherwise fairly expensive.
+ *
+ *   Changes to the geometry of the layer are detected, but the cache can be
+ *   dropped explicitly if needed.
+ */
+void AGKPOPQuadCoalescerInvalidate(CALayer *layer);
+
+/**
+ * @discussion
+ *   Applies all buffered writes immediately. Normally not needed as this is done
+ *   by the animator at the end of every frame.
+ */
+void AGKPOPQuadCoalescerFlush(void);
@@ -0,0 +1,325 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "AGKPOPQuadCoalescer.h"
+#import "CALayer+AGKQuad.h"
+#import "AGKQuad+AGKPOPValues.h"
+#import "AGKPOPHomography.h"
+#import "CATransform3D+AGKPOPHomography.h"
+#import <objc/runtime.h>
+#import <POP/POP.h>
+
+// Mirrors the observer interface declared in POPAnimatorPrivate.h which is not
+// part of the public headers of the pod.
+@protocol AGKPOPAnimatorObserving <NSObject>
+- (void)animatorDidAnimate:(POPAnimator *)animator;
+@end
+
+@interface POPAnimator (AGKPOPObserving)
+- (void)addObserver:(id<AGKPOPAnimatorObserving>)observer;
+- (void)removeObserver:(id<AGKPOPAnimatorObserving>)observer;
+@end
+
+@interface AGKPOPQuadLayerState : NSObject
+{
+@public
+    AGKQuad pendingQuad;
+    BOOL dirty;
+
+    // Last known quadrilateral together with the geometry it was derived from
+    AGKQuad cachedQuad;
+    CATransform3D cachedTransform;
+    CATransform3D cachedSublayerTransform;
+    CGRect cachedBounds;
+    CGPoint cachedPosition;
+    __unsafe_unretained CALayer *cachedSuperlayer;
+    BOOL cacheValid;
+
+    // Transform of cachedQuad relative to the position, updated a corner at a time
+    AGKPOPHomographyState homography;
+    BOOL homographyValid;
+}
+@end
+
+@implementation AGKPOPQuadLayerState
+@end
+
+@interface AGKPOPQuadCoalescer : NSObject <AGKPOPAnimatorObserving>
+
+@property (nonatomic, strong) NSMutableArray *dirtyLayers;
+@property (nonatomic, strong) NSMutableArray *flushingLayers;
+@property (nonatomic, assign) BOOL observing;
+
++ (instancetype)sharedCoalescer;
+
+@end
+
+static char kAGKPOPQuadLayerStateKey;
+
+static AGKPOPQuadLayerState *AGKPOPQuadLayerStateForLayer(CALayer *layer, BOOL create)
+{
+    AGKPOPQuadLayerState *state = objc_getAssociatedObject(layer, &kAGKPOPQuadLayerStateKey);
+    if(state == nil && create)
+    {
+        state = [AGKPOPQuadLayerState new];
+        objc_setAssociatedObject(layer, &kAGKPOPQuadLayerStateKey, state, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    }
+    return state;
+}
+
+static void AGKPOPQuadLayerStateStore(AGKPOPQuadLayerState *state, CALayer *layer, AGKQuad quad)
+{
+    CALayer *superlayer = layer.superlayer;
+    state->cachedQuad = quad;
+    state->cachedTransform = layer.transform;
+    state->cachedSublayerTransform = superlayer.sublayerTransform;
+    state->cachedBounds = layer.bounds;
+    state->cachedPosition = layer.position;
+    state->cachedSuperlayer = superlayer;
+    state->cacheValid = YES;
+}
+
+static BOOL AGKPOPQuadLayerStateIsCurrent(AGKPOPQuadLayerState *state, CALayer *layer)
+{
+    if(!state->cacheValid)
+    {
+        return NO;
+    }
+
+    CALayer *superlayer = layer.superlayer;
+    return superlayer == state->cachedSuperlayer
+        && CGPointEqualToPoint(layer.anchorPoint, CGPointZero)
+        && CGPointEqualToPoint(layer.position, state->cachedPosition)
+        && CGRectEqualToRect(layer.bounds, state->cachedBounds)
+        && CATransform3DEqualToTransform(layer.transform, state->cachedTransform)
+        && CATransform3DEqualToTransform(superlayer.sublayerTransform, state->cachedSublayerTransform);
+}
+
+// Dragging or springing single corners moves one or two corners per frame. The
+// transform is then updated from the previous one instead of solved again.
+static BOOL AGKPOPQuadLayerApplyMovedCorners(AGKPOPQuadLayerState *state, CALayer *layer, AGKQuad quad)
+{
+    if(!AGKPOPQuadLayerStateIsCurrent(state, layer) || !AGKPOPQuadContainsValidValues(quad) || !AGKQuadIsConvex(quad))
+    {
+        return NO;
+    }
+
+    AGKPOPQuadValues from = AGKPOPQuadValuesMake(state->cachedQuad);
+    AGKPOPQuadValues to = AGKPOPQuadValuesMake(quad);
+    int moved[4];
+    int movedCount = 0;
+    for(int i = 0; i < 4; i++)
+    {
+        if(!CGPointEqualToPoint(from.v[i], to.v[i]))
+        {
+            moved[movedCount++] = i;
+        }
+    }
+    if(movedCount == 0)
+    {
+        return YES;
+    }
+    if(movedCount > 2)
+    {
+        return NO;
+    }
+
+    CGPoint position = layer.position;
+    if(!state->homographyValid)
+    {
+        double inner[8];
+        AGKPOPQuadGetDoubles(AGKQuadMove(state->cachedQuad, -position.x, -position.y), inner);
+        CGSize size = layer.bounds.size;
+        state->homographyValid = AGKPOPHomographyStateInit(&state->homography, 0, 0, size.width, size.height, inner);
+    }
+    for(int i = 0; i < movedCount && state->homographyValid; i++)
+    {
+        int corner = moved[i];
+        double dx = (to.v[corner].x - position.x) - state->homography.quad[corner * 2];
+        double dy = (to.v[corner].y - position.y) - state->homography.quad[corner * 2 + 1];
+        state->homographyValid = AGKPOPHomographyStateMoveCorner(&state->homography, corner, dx, dy);
+    }
+    if(!state->homographyValid)
+    {
+        return NO;
+    }
+
+    layer.transform = CATransform3DWithHomography_AGKPOP(state->homography.h);
+    AGKPOPQuadLayerStateStore(state, layer, quad);
+    return YES;
+}
+
+static void AGKPOPQuadLayerApply(CALayer *layer, AGKQuad quad)
+{
+    AGKPOPQuadLayerState *state = AGKPOPQuadLayerStateForLayer(layer, YES);
+    if(AGKPOPQuadLayerApplyMovedCorners(state, layer, quad))
+    {
+        return;
+    }
+
+    state->homographyValid = NO;
+    BOOL anchorPointWasZero = CGPointEqualToPoint(layer.anchorPoint, CGPointZero);
+
+    layer.quadrilateral = quad;
+
+    // The setter silently ignores invalid quads and moves the layer when fixing
+    // the anchor point, in which case the quad does not describe the layer
+    if(anchorPointWasZero && !AGKPOPQuadEqual(quad, AGKQuadZero) && AGKPOPQuadContainsValidValues(quad) && AGKQuadIsConvex(quad))
+    {
+        AGKPOPQuadLayerStateStore(state, layer, quad);
+    }
+    else
+    {
+        state->cacheValid = NO;
+    }
+}
+
+@implementation AGKPOPQuadCoalescer
+
++ (instancetype)sharedCoalescer
+{
+    static AGKPOPQuadCoalescer *coalescer;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        coalescer = [AGKPOPQuadCoalescer new];
+    });
+    return coalescer;
+}
+
+- (instancetype)init
+{
+    self = [super init];
+    if(self)
+    {
+        self.dirtyLayers = [NSMutableArray array];
+        self.flushingLayers = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (BOOL)startObserving
+{
+    if(!self.observing)
+    {
+        POPAnimator *animator = [POPAnimator sharedAnimator];
+        if(![animator respondsToSelector:@selector(addObserver:)])
+        {
+            return NO;
+        }
+        [animator addObserver:self];
+        self.observing = YES;
+    }
+    return YES;
+}
+
+- (void)stopObserving
+{
+    if(self.observing)
+    {
+        // Staying registered would keep the display link of the animator running
+        [[POPAnimator sharedAnimator] removeObserver:self];
+        self.observing = NO;
+    }
+}
+
+- (void)write:(AGKQuad)quad toLayer:(CALayer *)layer
+{
+    if(![self startObserving])
+    {
+        AGKPOPQuadLayerApply(layer, quad);
+        return;
+    }
+
+    AGKPOPQuadLayerState *state = AGKPOPQuadLayerStateForLayer(layer, YES);
+    state->pendingQuad = quad;
+    if(!state->dirty)
+    {
+        state->dirty = YES;
+        [self.dirtyLayers addObject:layer];
+    }
+}
+
+- (void)flush
+{
+    // Swap the two lists rather than allocating a new one every frame
+    NSMutableArray *layers = self.dirtyLayers;
+    self.dirtyLayers = self.flushingLayers;
+    self.flushingLayers = layers;
+
+    for(CALayer *layer in layers)
+    {
+        AGKPOPQuadLayerState *state = AGKPOPQuadLayerStateForLayer(layer, NO);
+        state->dirty = NO;
+        AGKPOPQuadLayerApply(layer, state->pendingQuad);
+    }
+
+    [layers removeAllObjects];
+}
+
+- (void)animatorDidAnimate:(POPAnimator *)animator
+{
+    [self flush];
+    [self stopObserving];
+}
+
+@end
+
+AGKQuad AGKPOPQuadCoalescerRead(CALayer *layer)
+{
+    AGKPOPQuadLayerState *state = AGKPOPQuadLayerStateForLayer(layer, YES);
+    if(state->dirty)
+    {
+        return state->pendingQuad;
+    }
+    if(AGKPOPQuadLayerStateIsCurrent(state, layer))
+    {
+        return state->cachedQuad;
+    }
+
+    AGKQuad quad = layer.quadrilateral;
+    AGKPOPQuadLayerStateStore(state, layer, quad);
+    state->homographyValid = NO;
+    return quad;
+}
+
+void AGKPOPQuadCoalescerWrite(CALayer *layer, AGKQuad quad)
+{
+    [[AGKPOPQuadCoalescer sharedCoalescer] write:quad toLayer:layer];
+}
+
+void AGKPOPQuadCoalescerInvalidate(CALayer *layer)
+{
+    AGKPOPQuadLayerState *state = AGKPOPQuadLayerStateForLayer(layer, NO);
+    if(state == nil)
+    {
+        // Never written through the coalescer, so nothing is cached
+        return;
+    }
+    state->cacheValid = NO;
+    state->homographyValid = NO;
+}
+
+void AGKPOPQuadCoalescerFlush(void)
+{
+    [[AGKPOPQuadCoalescer sharedCoalescer] flush];
+}
@@ -0,0 +1,223 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "AGKPOPQuadSpringSystem.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct AGKPOPQuadSpringSystem {
+    AGKPOPSpringBatch *batch;
+
+    // Targets indexed by the slot of the spring handle
+    double *targets;
+    size_t targetCapacity;
+
+    double time;        // NAN while the clock is stopped
+};
+
+AGKPOPQuadSpringSystem *AGKPOPQuadSpringSystemCreate(void)
+{
+    AGKPOPQuadSpringSystem *system = calloc(1, sizeof(AGKPOPQuadSpringSystem));
+    if(system == NULL)
+    {
+        return NULL;
+    }
+
+    system->batch = AGKPOPSpringBatchCreate(kAGKPOPQuadSpringSystemValueCount);
+    if(system->batch == NULL)
+    {
+        free(system);
+        return NULL;
+    }
+    system->time = NAN;
+    return system;
+}
+
+void AGKPOPQuadSpringSystemDestroy(AGKPOPQuadSpringSystem *system)
+{
+    if(system == NULL)
+    {
+        return;
+    }
+
+    AGKPOPSpringBatchDestroy(system->batch);
+    free(system->targets);
+    free(system);
+}
+
+bool AGKPOPQuadSpringSystemIsClockRunning(const AGKPOPQuadSpringSystem *system)
+{
+    return !isnan(system->time);
+}
+
+double AGKPOPQuadSpringSystemTime(const AGKPOPQuadSpringSystem *system)
+{
+    return system->time;
+}
+
+void AGKPOPQuadSpringSystemSetTime(AGKPOPQuadSpringSystem *system, double time)
+{
+    system->time = time;
+}
+
+void AGKPOPQuadSpringSystemStopClock(AGKPOPQuadSpringSystem *system)
+{
+    system->time = NAN;
+}
+
+void AGKPOPQuadSpringSystemStep(AGKPOPQuadSpringSystem *system, double dt)
+{
+    AGKPOPSpringBatchAdvance(system->batch, dt);
+    if(!isnan(system->time))
+    {
+        system->time += dt;
+    }
+}
+
+void AGKPOPQuadSpringSystemAdvanceToTime(AGKPOPQuadSpringSystem *system, double time)
+{
+    if(!isnan(system->time) && time > system->time)
+    {
+        AGKPOPSpringBatchAdvance(system->batch, time - system->time);
+    }
+    system->time = time;
+}
+
+static double *AGKPOPQuadSpringSystemTarget(const AGKPOPQuadSpringSystem *system, AGKPOPSpringBatchHandle spring)
+{
+    return system->targets + AGKPOPSpringBatchHandleSlot(spring) * kAGKPOPQuadSpringSystemValueCount;
+}
+
+AGKPOPSpringBatchHandle AGKPOPQuadSpringSystemAdd(AGKPOPQuadSpringSystem *system,
+                                                  const double values[8],
+                                                  const double target[8],
+                                                  double tension,
+                                                  double friction,
+                                                  double mass)
+{
+    AGKPOPSpringBatchHandle spring = AGKPOPSpringBatchAdd(system->batch, tension, friction, mass);
+    if(spring == kAGKPOPSpringBatchInvalidHandle)
+    {
+        return spring;
+    }
+
+    size_t slot = AGKPOPSpringBatchHandleSlot(spring);
+    if(slot >= system->targetCapacity)
+    {
+        size_t capacity = system->targetCapacity == 0 ? 16 : system->targetCapacity * 2;
+        if(capacity <= slot)
+        {
+            capacity = slot + 1;
+        }
+
+        double *targets = realloc(system->targets, capacity * kAGKPOPQuadSpringSystemValueCount * sizeof(double));
+        if(targets == NULL)
+        {
+            AGKPOPSpringBatchRemove(system->batch, spring);
+            return kAGKPOPSpringBatchInvalidHandle;
+        }
+        system->targets = targets;
+        system->targetCapacity = capacity;
+    }
+
+    double *t = AGKPOPQuadSpringSystemTarget(system, spring);
+    double *p = AGKPOPSpringBatchPositions(system->batch, spring);
+    for(size_t i = 0; i < kAGKPOPQuadSpringSystemValueCount; i++)
+    {
+        t[i] = target[i];
+        p[i] = values[i] - target[i];
+    }
+    return spring;
+}
+
+bool AGKPOPQuadSpringSystemRetarget(AGKPOPQuadSpringSystem *system,
+                                    AGKPOPSpringBatchHandle spring,
+                                    const double target[8],
+                                    double tension,
+                                    double friction,
+                                    double mass)
+{
+    double *p = AGKPOPSpringBatchPositions(system->batch, spring);
+    if(p == NULL)
+    {
+        return false;
+    }
+
+    // Positions are relative to the target, move them along with it
+    double *t = AGKPOPQuadSpringSystemTarget(system, spring);
+    for(size_t i = 0; i < kAGKPOPQuadSpringSystemValueCount; i++)
+    {
+        p[i] += t[i] - target[i];
+        t[i] = target[i];
+    }
+    AGKPOPSpringBatchSetConstants(system->batch, spring, tension, friction, mass);
+    return true;
+}
+
+void AGKPOPQuadSpringSystemRemove(AGKPOPQuadSpringSystem *system, AGKPOPSpringBatchHandle spring)
+{
+    AGKPOPSpringBatchRemove(system->batch, spring);
+}
+
+bool AGKPOPQuadSpringSystemContains(const AGKPOPQuadSpringSystem *system, AGKPOPSpringBatchHandle spring)
+{
+    return AGKPOPSpringBatchContains(system->batch, spring);
+}
+
+size_t AGKPOPQuadSpringSystemCount(const AGKPOPQuadSpringSystem *system)
+{
+    return AGKPOPSpringBatchCount(system->batch);
+}
+
+bool AGKPOPQuadSpringSystemGetValues(AGKPOPQuadSpringSystem *system, AGKPOPSpringBatchHandle spring, double out[8])
+{
+    const double *p = AGKPOPSpringBatchPositions(system->batch, spring);
+    if(p == NULL)
+    {
+        return false;
+    }
+
+    const double *t = AGKPOPQuadSpringSystemTarget(system, spring);
+    for(size_t i = 0; i < kAGKPOPQuadSpringSystemValueCount; i++)
+    {
+        out[i] = t[i] + p[i];
+    }
+    return true;
+}
+
+bool AGKPOPQuadSpringSystemGetTarget(const AGKPOPQuadSpringSystem *system, AGKPOPSpringBatchHandle spring, double out[8])
+{
+    if(!AGKPOPSpringBatchContains(system->batch, spring))
+    {
+        return false;
+    }
+
+    memcpy(out, AGKPOPQuadSpringSystemTarget(system, spring), kAGKPOPQuadSpringSystemValueCount * sizeof(double));
+    return true;
+}
+
+bool AGKPOPQuadSpringSystemHasConverged(const AGKPOPQuadSpringSystem *system, AGKPOPSpringBatchHandle spring, double threshold)
+{
+    return AGKPOPSpringBatchHasConverged(system->batch, spring, threshold);
+}
@@ -0,0 +1,98 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef AGKPOPQuadSpringSystem_h
+#define AGKPOPQuadSpringSystem_h
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "AGKBaseDefines.h"
+#include "AGKPOPSpringBatch.h"
+
+AGK_EXTERN_C_BEGIN
+
+/*
+ Quad springs driven by an explicit clock instead of a display link. This is
+ what CALayer+AGKPOPQuadSpring runs on, and it has no Objective-C or UI
+ dependencies, so it can render spring animations frame by frame on a server or
+ drive a benchmark with exactly the same time steps on every run.
+
+ Values are the 8 corner coordinates in the order tl.x, tl.y, tr.x, tr.y, br.x,
+ br.y, bl.x, bl.y. The springs are solved in closed form, so the result at a
+ given time does not depend on how the time is split into steps.
+
+ The clock starts stopped. While it is stopped `AGKPOPQuadSpringSystemAdvanceToTime`
+ only starts it. Set it with `AGKPOPQuadSpringSystemSetTime` before adding
+ springs to have them move from that time on.
+ */
+
+#define kAGKPOPQuadSpringSystemValueCount 8
+
+typedef struct AGKPOPQuadSpringSystem AGKPOPQuadSpringSystem;
+
+AGKPOPQuadSpringSystem *AGKPOPQuadSpringSystemCreate(void);
+void AGKPOPQuadSpringSystemDestroy(AGKPOPQuadSpringSystem *system);
+
+bool AGKPOPQuadSpringSystemIsClockRunning(const AGKPOPQuadSpringSystem *system);
+double AGKPOPQuadSpringSystemTime(const AGKPOPQuadSpringSystem *system);
+void AGKPOPQuadSpringSystemSetTime(AGKPOPQuadSpringSystem *system, double time);
+void AGKPOPQuadSpringSystemStopClock(AGKPOPQuadSpringSystem *system);
+
+void AGKPOPQuadSpringSystemStep(AGKPOPQuadSpringSystem *system, double dt);
+void AGKPOPQuadSpringSystemAdvanceToTime(AGKPOPQuadSpringSystem *system, double time);
+
+/**
+ * @discussion
+ *   Adds a spring at rest at `values` heading for `target`. Returns
+ *   kAGKPOPSpringBatchInvalidHandle when out of memory.
+ */
+AGKPOPSpringBatchHandle AGKPOPQuadSpringSystemAdd(AGKPOPQuadSpringSystem *system,
+                                                  const double values[8],
+                                                  const double target[8],
+                                                  double tension,
+                                                  double friction,
+                                                  double mass);
+
+/**
+ * @discussion
+ *   Changes target and constants of a running spring, keeping its current
+ *   values and velocity.
+ */
+bool AGKPOPQuadSpringSystemRetarget(AGKPOPQuadSpringSystem *system,
+                                    AGKPOPSpringBatchHandle spring,
+                                    const double target[8],
+                                    double tension,
+                                    double friction,
+                                    double mass);
+
+void AGKPOPQuadSpringSystemRemove(AGKPOPQuadSpringSystem *system, AGKPOPSpringBatchHandle spring);
+bool AGKPOPQuadSpringSystemContains(const AGKPOPQuadSpringSystem *system, AGKPOPSpringBatchHandle spring);
+size_t AGKPOPQuadSpringSystemCount(const AGKPOPQuadSpringSystem *system);
+
+bool AGKPOPQuadSpringSystemGetValues(AGKPOPQuadSpringSystem *system, AGKPOPSpringBatchHandle spring, double out[8]);
+bool AGKPOPQuadSpringSystemGetTarget(const AGKPOPQuadSpringSystem *system, AGKPOPSpringBatchHandle spring, double out[8]);
+bool AGKPOPQuadSpringSystemHasConverged(const AGKPOPQuadSpringSystem *system, AGKPOPSpringBatchHandle spring, double threshold);
+
+AGK_EXTERN_C_END
+
+#endif
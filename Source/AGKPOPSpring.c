@@ -0,0 +1,156 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "AGKPOPSpring.h"
+#include <math.h>
+
+const double kAGKPOPSpringMaxStep = 30.0;
+
+// Relative distance from critical damping treated as critically damped. Keeps
+// the divisions by the damped frequency and the root difference well defined.
+static const double kAGKPOPSpringCriticalEpsilon = 1e-6;
+
+AGKPOPSpringStep AGKPOPSpringStepMake(double tension, double friction, double mass, double dt)
+{
+    AGKPOPSpringStep s;
+
+    if(dt <= 0.0 || mass <= 0.0)
+    {
+        s.pp = 1.0; s.pv = 0.0;
+        s.vp = 0.0; s.vv = 1.0;
+        return s;
+    }
+
+    double w0sq = tension / mass;   // squared natural frequency
+    double alpha = friction / (2.0 * mass);  // decay rate
+
+    if(w0sq <= 0.0)
+    {
+        // No spring force, only friction slowing down the movement
+        if(alpha <= 0.0)
+        {
+            s.pp = 1.0; s.pv = dt;
+            s.vp = 0.0; s.vv = 1.0;
+        }
+        else
+        {
+            double decay = exp(-2.0 * alpha * dt);
+            s.pp = 1.0; s.pv = (1.0 - decay) / (2.0 * alpha);
+            s.vp = 0.0; s.vv = decay;
+        }
+        return s;
+    }
+
+    double disc = alpha * alpha - w0sq;
+
+    if(fabs(disc) <= kAGKPOPSpringCriticalEpsilon * w0sq)
+    {
+        // Critically damped: p = e^(-wt) * (p0 + (v0 + w * p0) * t)
+        double w = sqrt(w0sq);
+        double e = exp(-w * dt);
+        s.pp = e * (1.0 + w * dt);
+        s.pv = e * dt;
+        s.vp = -e * w0sq * dt;
+        s.vv = e * (1.0 - w * dt);
+    }
+    else if(disc < 0.0)
+    {
+        // Underdamped: oscillates with the damped frequency wd
+        double wd = sqrt(-disc);
+        double e = exp(-alpha * dt);
+        double c = cos(wd * dt);
+        double sn = sin(wd * dt) / wd;
+        s.pp = e * (c + alpha * sn);
+        s.pv = e * sn;
+        s.vp = -e * w0sq * sn;
+        s.vv = e * (c - alpha * sn);
+    }
+    else
+    {
+        // Overdamped: sum of two decaying exponentials with rates r1 and r2
+        double root = sqrt(disc);
+        double r1 = -alpha + root;
+        double r2 = -alpha - root;
+        double e1 = exp(r1 * dt);
+        double e2 = exp(r2 * dt);
+        double inv = 1.0 / (r1 - r2);
+        s.pp = (r1 * e2 - r2 * e1) * inv;
+        s.pv = (e1 - e2) * inv;
+        s.vp = r1 * r2 * (e2 - e1) * inv;
+        s.vv = (r1 * e1 - r2 * e2) * inv;
+    }
+
+    return s;
+}
+
+void AGKPOPSpringStepApply(AGKPOPSpringStep step, double *p, double *v)
+{
+    double p0 = *p;
+    double v0 = *v;
+    *p = step.pp * p0 + step.pv * v0;
+    *v = step.vp * p0 + step.vv * v0;
+}
+
+void AGKPOPSpringEvaluate(double tension, double friction, double mass,
+                          double p0, double v0, double t,
+                          double *outP, double *outV)
+{
+    AGKPOPSpringStep step = AGKPOPSpringStepMake(tension, friction, mass, t);
+    double p = p0;
+    double v = v0;
+    AGKPOPSpringStepApply(step, &p, &v);
+
+    if(outP)
+    {
+        *outP = p;
+    }
+    if(outV)
+    {
+        *outV = v;
+    }
+}
+
+bool AGKPOPSpringHasConverged(const double *p, const double *v, size_t count,
+                              double tension, double friction, double mass,
+                              double threshold)
+{
+    double tp = threshold / 2.0;
+    double tv = 25.0 * threshold;
+    double ta = 625.0 * threshold * threshold;
+
+    double vv = 0.0;
+    double aa = 0.0;
+
+    for(size_t i = 0; i < count; i++)
+    {
+        if(fabs(p[i]) >= tp)
+        {
+            return false;
+        }
+        double a = (-tension * p[i] - friction * v[i]) / mass;
+        vv += v[i] * v[i];
+        aa += a * a;
+    }
+
+    return vv < tv && aa < ta;
+}
@@ -0,0 +1,87 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef AGKPOPSpring_h
+#define AGKPOPSpring_h
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "AGKBaseDefines.h"
+
+AGK_EXTERN_C_BEGIN
+
+/*
+ Closed form solution of the damped spring used by POPSpringAnimation
+
+     m * p'' = -k * p - b * p'
+
+ where k = tension, b = friction, m = mass and p is the distance left to the
+ target value. POP integrates this equation with RK4 in steps of 1 ms. The
+ equation is linear, so the exact state after any time step can be expressed as
+ a 2x2 matrix applied to position and velocity:
+
+     p(t + dt) = pp * p(t) + pv * v(t)
+     v(t + dt) = vp * p(t) + vv * v(t)
+
+ The matrix only depends on k, b, m and dt and is computed in constant time for
+ the under-, critically- and overdamped case.
+ */
+
+typedef struct AGKPOPSpringStep {
+    double pp, pv;
+    double vp, vv;
+} AGKPOPSpringStep;
+
+/**
+ * @discussion
+ *   Time steps longer than this makes POP shut the spring down, see `maxSolverDt`
+ *   in POPSpringSolver.h.
+ */
+extern const double kAGKPOPSpringMaxStep;
+
+AGKPOPSpringStep AGKPOPSpringStepMake(double tension, double friction, double mass, double dt);
+void AGKPOPSpringStepApply(AGKPOPSpringStep step, double *p, double *v);
+
+/**
+ * @discussion
+ *   Position and velocity `t` seconds after starting with position `p0` and
+ *   velocity `v0`.
+ */
+void AGKPOPSpringEvaluate(double tension, double friction, double mass,
+                          double p0, double v0, double t,
+                          double *outP, double *outV);
+
+/**
+ * @discussion
+ *   Same convergence test as `POP::SpringSolver::hasConverged()`. Every position
+ *   must be within half a threshold of the target and the squared norm of the
+ *   velocities and accelerations must be below 25 * threshold and
+ *   625 * threshold^2 respectively.
+ */
+bool AGKPOPSpringHasConverged(const double *p, const double *v, size_t count,
+                              double tension, double friction, double mass,
+                              double threshold);
+
+AGK_EXTERN_C_END
+
+#endif
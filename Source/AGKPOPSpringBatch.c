@@ -0,0 +1,433 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "AGKPOPSpringBatch.h"
+#include "AGKPOPSpring.h"
+#include "AGKPOPParallel.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define AGKPOP_SPRING_BATCH_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define AGKPOP_SPRING_BATCH_NEON 1
+#endif
+
+const AGKPOPSpringBatchHandle kAGKPOPSpringBatchInvalidHandle = UINT64_MAX;
+
+// Components per parallel task and the smallest batch worth splitting up
+static const size_t kAGKPOPSpringBatchLanesPerChunk = 16 * 1024;
+static const size_t kAGKPOPSpringBatchMinParallelLanes = 4 * kAGKPOPSpringBatchLanesPerChunk;
+
+struct AGKPOPSpringBatch {
+    size_t dimension;
+    size_t capacity;    // springs allocated
+    size_t count;       // live springs, packed in [0, count)
+
+    // Per live spring
+    double *tension;
+    double *friction;
+    double *mass;
+    bool *dirty;        // constants changed since the coefficients were computed
+    uint32_t *slotOf;   // slot referring to the spring
+
+    // Per slot
+    uint32_t *generation;
+    size_t *springOf;   // index of the live spring, only valid for used slots
+
+    // Stack of free slots, lowest slot on top after growing
+    uint32_t *freeSlots;
+    size_t freeCount;
+
+    // Per component, capacity * dimension
+    double *p;
+    double *v;
+    double *pp, *pv, *vp, *vv;
+
+    double stepDt;      // time step the coefficients were computed for
+    bool parallel;
+};
+
+static inline AGKPOPSpringBatchHandle AGKPOPSpringBatchMakeHandle(uint32_t slot, uint32_t generation)
+{
+    return ((uint64_t)generation << 32) | slot;
+}
+
+static const size_t kAGKPOPSpringBatchNotFound = SIZE_MAX;
+
+// Index of the live spring for a handle, or kAGKPOPSpringBatchNotFound
+static inline size_t AGKPOPSpringBatchFind(const AGKPOPSpringBatch *batch, AGKPOPSpringBatchHandle handle)
+{
+    uint32_t slot = (uint32_t)handle;
+    uint32_t generation = (uint32_t)(handle >> 32);
+    if(slot >= batch->capacity || batch->generation[slot] != generation)
+    {
+        return kAGKPOPSpringBatchNotFound;
+    }
+
+    size_t spring = batch->springOf[slot];
+    if(spring >= batch->count || batch->slotOf[spring] != slot)
+    {
+        return kAGKPOPSpringBatchNotFound;
+    }
+    return spring;
+}
+
+// Reallocates the array stored at arrayPointer, which may be of any type
+static bool AGKPOPSpringBatchResize(void *arrayPointer, size_t count, size_t size)
+{
+    void *array;
+    memcpy(&array, arrayPointer, sizeof(array));
+    void *resized = realloc(array, count * size);
+    if(resized == NULL)
+    {
+        return false;
+    }
+    memcpy(arrayPointer, &resized, sizeof(resized));
+    return true;
+}
+
+static bool AGKPOPSpringBatchGrow(AGKPOPSpringBatch *batch, size_t minimumCapacity)
+{
+    size_t capacity = batch->capacity == 0 ? 16 : batch->capacity * 2;
+    if(capacity < minimumCapacity)
+    {
+        capacity = minimumCapacity;
+    }
+    if(capacity > UINT32_MAX)
+    {
+        return false;
+    }
+    size_t lanes = capacity * batch->dimension;
+
+    if(!AGKPOPSpringBatchResize(&batch->tension, capacity, sizeof(double)) ||
+       !AGKPOPSpringBatchResize(&batch->friction, capacity, sizeof(double)) ||
+       !AGKPOPSpringBatchResize(&batch->mass, capacity, sizeof(double)) ||
+       !AGKPOPSpringBatchResize(&batch->dirty, capacity, sizeof(bool)) ||
+       !AGKPOPSpringBatchResize(&batch->slotOf, capacity, sizeof(uint32_t)) ||
+       !AGKPOPSpringBatchResize(&batch->generation, capacity, sizeof(uint32_t)) ||
+       !AGKPOPSpringBatchResize(&batch->springOf, capacity, sizeof(size_t)) ||
+       !AGKPOPSpringBatchResize(&batch->freeSlots, capacity, sizeof(uint32_t)) ||
+       !AGKPOPSpringBatchResize(&batch->p, lanes, sizeof(double)) ||
+       !AGKPOPSpringBatchResize(&batch->v, lanes, sizeof(double)) ||
+       !AGKPOPSpringBatchResize(&batch->pp, lanes, sizeof(double)) ||
+       !AGKPOPSpringBatchResize(&batch->pv, lanes, sizeof(double)) ||
+       !AGKPOPSpringBatchResize(&batch->vp, lanes, sizeof(double)) ||
+       !AGKPOPSpringBatchResize(&batch->vv, lanes, sizeof(double)))
+    {
+        return false;
+    }
+
+    size_t added = capacity - batch->capacity;
+    memset(batch->generation + batch->capacity, 0, added * sizeof(uint32_t));
+    for(size_t slot = capacity; slot > batch->capacity; slot--)
+    {
+        batch->freeSlots[batch->freeCount++] = (uint32_t)(slot - 1);
+    }
+
+    batch->capacity = capacity;
+    return true;
+}
+
+AGKPOPSpringBatch *AGKPOPSpringBatchCreate(size_t dimension)
+{
+    if(dimension == 0)
+    {
+        return NULL;
+    }
+
+    AGKPOPSpringBatch *batch = calloc(1, sizeof(AGKPOPSpringBatch));
+    if(batch == NULL)
+    {
+        return NULL;
+    }
+    batch->dimension = dimension;
+    batch->stepDt = -1.0;
+    return batch;
+}
+
+void AGKPOPSpringBatchDestroy(AGKPOPSpringBatch *batch)
+{
+    if(batch == NULL)
+    {
+        return;
+    }
+
+    free(batch->tension);
+    free(batch->friction);
+    free(batch->mass);
+    free(batch->dirty);
+    free(batch->slotOf);
+    free(batch->generation);
+    free(batch->springOf);
+    free(batch->freeSlots);
+    free(batch->p);
+    free(batch->v);
+    free(batch->pp);
+    free(batch->pv);
+    free(batch->vp);
+    free(batch->vv);
+    free(batch);
+}
+
+bool AGKPOPSpringBatchReserve(AGKPOPSpringBatch *batch, size_t capacity)
+{
+    if(capacity <= batch->capacity)
+    {
+        return true;
+    }
+    return AGKPOPSpringBatchGrow(batch, capacity);
+}
+
+static void AGKPOPSpringBatchSetConstantsAt(AGKPOPSpringBatch *batch, size_t spring, double tension, double friction, double mass)
+{
+    batch->tension[spring] = tension;
+    batch->friction[spring] = friction;
+    batch->mass[spring] = mass;
+    batch->dirty[spring] = true;
+}
+
+AGKPOPSpringBatchHandle AGKPOPSpringBatchAdd(AGKPOPSpringBatch *batch, double tension, double friction, double mass)
+{
+    if(batch->freeCount == 0 && !AGKPOPSpringBatchGrow(batch, 0))
+    {
+        return kAGKPOPSpringBatchInvalidHandle;
+    }
+
+    uint32_t slot = batch->freeSlots[--batch->freeCount];
+    size_t spring = batch->count++;
+    batch->springOf[slot] = spring;
+    batch->slotOf[spring] = slot;
+
+    size_t first = spring * batch->dimension;
+    memset(batch->p + first, 0, batch->dimension * sizeof(double));
+    memset(batch->v + first, 0, batch->dimension * sizeof(double));
+    AGKPOPSpringBatchSetConstantsAt(batch, spring, tension, friction, mass);
+
+    return AGKPOPSpringBatchMakeHandle(slot, batch->generation[slot]);
+}
+
+void AGKPOPSpringBatchRemove(AGKPOPSpringBatch *batch, AGKPOPSpringBatchHandle handle)
+{
+    size_t spring = AGKPOPSpringBatchFind(batch, handle);
+    if(spring == kAGKPOPSpringBatchNotFound)
+    {
+        return;
+    }
+
+    uint32_t slot = batch->slotOf[spring];
+    size_t last = --batch->count;
+
+    if(spring != last)
+    {
+        // Move the last spring into the hole
+        size_t dimension = batch->dimension;
+        size_t to = spring * dimension;
+        size_t from = last * dimension;
+        size_t bytes = dimension * sizeof(double);
+        memcpy(batch->p + to, batch->p + from, bytes);
+        memcpy(batch->v + to, batch->v + from, bytes);
+        memcpy(batch->pp + to, batch->pp + from, bytes);
+        memcpy(batch->pv + to, batch->pv + from, bytes);
+        memcpy(batch->vp + to, batch->vp + from, bytes);
+        memcpy(batch->vv + to, batch->vv + from, bytes);
+
+        batch->tension[spring] = batch->tension[last];
+        batch->friction[spring] = batch->friction[last];
+        batch->mass[spring] = batch->mass[last];
+        batch->dirty[spring] = batch->dirty[last];
+
+        uint32_t movedSlot = batch->slotOf[last];
+        batch->slotOf[spring] = movedSlot;
+        batch->springOf[movedSlot] = spring;
+    }
+
+    batch->generation[slot]++;
+    batch->freeSlots[batch->freeCount++] = slot;
+}
+
+bool AGKPOPSpringBatchContains(const AGKPOPSpringBatch *batch, AGKPOPSpringBatchHandle spring)
+{
+    return AGKPOPSpringBatchFind(batch, spring) != kAGKPOPSpringBatchNotFound;
+}
+
+size_t AGKPOPSpringBatchHandleSlot(AGKPOPSpringBatchHandle spring)
+{
+    return (uint32_t)spring;
+}
+
+size_t AGKPOPSpringBatchCount(const AGKPOPSpringBatch *batch)
+{
+    return batch->count;
+}
+
+void AGKPOPSpringBatchSetParallel(AGKPOPSpringBatch *batch, bool parallel)
+{
+    batch->parallel = parallel;
+}
+
+void AGKPOPSpringBatchSetConstants(AGKPOPSpringBatch *batch, AGKPOPSpringBatchHandle handle, double tension, double friction, double mass)
+{
+    size_t spring = AGKPOPSpringBatchFind(batch, handle);
+    if(spring != kAGKPOPSpringBatchNotFound)
+    {
+        AGKPOPSpringBatchSetConstantsAt(batch, spring, tension, friction, mass);
+    }
+}
+
+double *AGKPOPSpringBatchPositions(AGKPOPSpringBatch *batch, AGKPOPSpringBatchHandle handle)
+{
+    size_t spring = AGKPOPSpringBatchFind(batch, handle);
+    return spring == kAGKPOPSpringBatchNotFound ? NULL : batch->p + spring * batch->dimension;
+}
+
+double *AGKPOPSpringBatchVelocities(AGKPOPSpringBatch *batch, AGKPOPSpringBatchHandle handle)
+{
+    size_t spring = AGKPOPSpringBatchFind(batch, handle);
+    return spring == kAGKPOPSpringBatchNotFound ? NULL : batch->v + spring * batch->dimension;
+}
+
+static void AGKPOPSpringBatchUpdateCoefficients(AGKPOPSpringBatch *batch, double dt)
+{
+    bool all = dt != batch->stepDt;
+    size_t dimension = batch->dimension;
+
+    for(size_t spring = 0; spring < batch->count; spring++)
+    {
+        if(!all && !batch->dirty[spring])
+        {
+            continue;
+        }
+
+        AGKPOPSpringStep step = AGKPOPSpringStepMake(batch->tension[spring], batch->friction[spring], batch->mass[spring], dt);
+        size_t first = spring * dimension;
+        for(size_t i = first; i < first + dimension; i++)
+        {
+            batch->pp[i] = step.pp;
+            batch->pv[i] = step.pv;
+            batch->vp[i] = step.vp;
+            batch->vv[i] = step.vv;
+        }
+        batch->dirty[spring] = false;
+    }
+
+    batch->stepDt = dt;
+}
+
+// Advances the components [first, last)
+static void AGKPOPSpringBatchAdvanceLanes(AGKPOPSpringBatch *batch, size_t first, size_t last)
+{
+    double * restrict p = batch->p;
+    double * restrict v = batch->v;
+    const double * restrict pp = batch->pp;
+    const double * restrict pv = batch->pv;
+    const double * restrict vp = batch->vp;
+    const double * restrict vv = batch->vv;
+    size_t i = first;
+
+    // Release builds are usually optimized for size (-Os) where the compiler
+    // does not vectorize loops, so the two-lane double kernel is spelled out.
+#if AGKPOP_SPRING_BATCH_SSE2
+    for(; i + 2 <= last; i += 2)
+    {
+        __m128d p0 = _mm_loadu_pd(p + i);
+        __m128d v0 = _mm_loadu_pd(v + i);
+        __m128d p1 = _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(pp + i), p0), _mm_mul_pd(_mm_loadu_pd(pv + i), v0));
+        __m128d v1 = _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(vp + i), p0), _mm_mul_pd(_mm_loadu_pd(vv + i), v0));
+        _mm_storeu_pd(p + i, p1);
+        _mm_storeu_pd(v + i, v1);
+    }
+#elif AGKPOP_SPRING_BATCH_NEON
+    for(; i + 2 <= last; i += 2)
+    {
+        float64x2_t p0 = vld1q_f64(p + i);
+        float64x2_t v0 = vld1q_f64(v + i);
+        float64x2_t p1 = vfmaq_f64(vmulq_f64(vld1q_f64(pp + i), p0), vld1q_f64(pv + i), v0);
+        float64x2_t v1 = vfmaq_f64(vmulq_f64(vld1q_f64(vp + i), p0), vld1q_f64(vv + i), v0);
+        vst1q_f64(p + i, p1);
+        vst1q_f64(v + i, v1);
+    }
+#endif
+
+    for(; i < last; i++)
+    {
+        double p0 = p[i];
+        double v0 = v[i];
+        p[i] = pp[i] * p0 + pv[i] * v0;
+        v[i] = vp[i] * p0 + vv[i] * v0;
+    }
+}
+
+static void AGKPOPSpringBatchAdvanceChunk(void *context, size_t chunk)
+{
+    AGKPOPSpringBatch *batch = context;
+    size_t lanes = batch->count * batch->dimension;
+    size_t first = chunk * kAGKPOPSpringBatchLanesPerChunk;
+    size_t last = first + kAGKPOPSpringBatchLanesPerChunk;
+    AGKPOPSpringBatchAdvanceLanes(batch, first, last < lanes ? last : lanes);
+}
+
+void AGKPOPSpringBatchAdvance(AGKPOPSpringBatch *batch, double dt)
+{
+    if(batch->count == 0 || dt <= 0.0)
+    {
+        return;
+    }
+
+    if(dt > kAGKPOPSpringMaxStep)
+    {
+        // Same as POP, an excessive time step brings every spring to rest
+        memset(batch->p, 0, batch->count * batch->dimension * sizeof(double));
+        memset(batch->v, 0, batch->count * batch->dimension * sizeof(double));
+        return;
+    }
+
+    AGKPOPSpringBatchUpdateCoefficients(batch, dt);
+
+    size_t lanes = batch->count * batch->dimension;
+    if(batch->parallel && lanes >= kAGKPOPSpringBatchMinParallelLanes)
+    {
+        size_t chunks = (lanes + kAGKPOPSpringBatchLanesPerChunk - 1) / kAGKPOPSpringBatchLanesPerChunk;
+        AGKPOPParallelApply(chunks, batch, AGKPOPSpringBatchAdvanceChunk);
+    }
+    else
+    {
+        AGKPOPSpringBatchAdvanceLanes(batch, 0, lanes);
+    }
+}
+
+bool AGKPOPSpringBatchHasConverged(const AGKPOPSpringBatch *batch, AGKPOPSpringBatchHandle handle, double threshold)
+{
+    size_t spring = AGKPOPSpringBatchFind(batch, handle);
+    if(spring == kAGKPOPSpringBatchNotFound)
+    {
+        return true;
+    }
+
+    size_t first = spring * batch->dimension;
+    return AGKPOPSpringHasConverged(batch->p + first, batch->v + first, batch->dimension,
+                                    batch->tension[spring], batch->friction[spring], batch->mass[spring],
+                                    threshold);
+}
@@ -0,0 +1,102 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef AGKPOPSpringBatch_h
+#define AGKPOPSpringBatch_h
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "AGKBaseDefines.h"
+
+AGK_EXTERN_C_BEGIN
+
+/*
+ Advances many springs at once. All springs in a batch have the same number of
+ components (8 for a quadrilateral) and positions, velocities and the step
+ coefficients of every component are kept in contiguous arrays. Advancing the
+ batch is then one loop of four multiplies and two adds per component, which
+ the compiler can vectorize, instead of one object and one solver per spring.
+
+ Positions are distances from the target, like in `AGKPOPSpringStep`.
+
+ Springs are referred to by handles holding a slot and a generation. Live
+ springs are packed densely, removing one moves the last spring into its place,
+ so the advance loop never runs over holes and removal is O(1). The generation
+ of a slot changes on removal, so a stale handle is recognized instead of
+ silently referring to a spring added later. Pointers returned by
+ `AGKPOPSpringBatchPositions` and `AGKPOPSpringBatchVelocities` are invalidated
+ by `AGKPOPSpringBatchAdd` and `AGKPOPSpringBatchRemove`.
+
+ Slots are recycled, so once the batch has grown to the number of springs
+ running at the same time (or `AGKPOPSpringBatchReserve` was called) adding and
+ removing springs no longer allocates.
+ */
+
+typedef struct AGKPOPSpringBatch AGKPOPSpringBatch;
+typedef uint64_t AGKPOPSpringBatchHandle;
+
+extern const AGKPOPSpringBatchHandle kAGKPOPSpringBatchInvalidHandle;
+
+AGKPOPSpringBatch *AGKPOPSpringBatchCreate(size_t dimension);
+void AGKPOPSpringBatchDestroy(AGKPOPSpringBatch *batch);
+
+bool AGKPOPSpringBatchReserve(AGKPOPSpringBatch *batch, size_t capacity);
+AGKPOPSpringBatchHandle AGKPOPSpringBatchAdd(AGKPOPSpringBatch *batch, double tension, double friction, double mass);
+void AGKPOPSpringBatchRemove(AGKPOPSpringBatch *batch, AGKPOPSpringBatchHandle spring);
+bool AGKPOPSpringBatchContains(const AGKPOPSpringBatch *batch, AGKPOPSpringBatchHandle spring);
+
+/**
+ * @discussion
+ *   The slot of a handle stays the same while the spring is in the batch and is
+ *   lower than the number of springs the batch has ever held at once, so it can
+ *   index side tables kept by the caller.
+ */
+size_t AGKPOPSpringBatchHandleSlot(AGKPOPSpringBatchHandle spring);
+size_t AGKPOPSpringBatchCount(const AGKPOPSpringBatch *batch);
+
+/**
+ * @discussion
+ *   These return NULL, false or do nothing for handles that are no longer in
+ *   the batch. A stale handle converges immediately.
+ */
+void AGKPOPSpringBatchSetConstants(AGKPOPSpringBatch *batch, AGKPOPSpringBatchHandle spring, double tension, double friction, double mass);
+double *AGKPOPSpringBatchPositions(AGKPOPSpringBatch *batch, AGKPOPSpringBatchHandle spring);
+double *AGKPOPSpringBatchVelocities(AGKPOPSpringBatch *batch, AGKPOPSpringBatchHandle spring);
+
+/**
+ * @discussion
+ *   Off by default. When on, batches of more than about 64k components are
+ *   advanced in chunks spread over all cores. The coefficients are updated
+ *   before on the calling thread, and `AGKPOPSpringBatchAdvance` returns when
+ *   every chunk is done, so reading the results afterwards is unchanged and
+ *   happens serially in whatever order the caller applies them.
+ */
+void AGKPOPSpringBatchSetParallel(AGKPOPSpringBatch *batch, bool parallel);
+
+void AGKPOPSpringBatchAdvance(AGKPOPSpringBatch *batch, double dt);
+bool AGKPOPSpringBatchHasConverged(const AGKPOPSpringBatch *batch, AGKPOPSpringBatchHandle spring, double threshold);
+
+AGK_EXTERN_C_END
+
+#endif
@@ -0,0 +1,1036 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "AGKPOPWarp.h"
+#include "AGKPOPParallel.h"
+#include "AGKPOPBufferPool.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define AGKPOP_WARP_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define AGKPOP_WARP_NEON 1
+#endif
+
+// Pixels per block of source coordinates computed ahead of fetching. Each block
+// starts from an exact evaluation so rounding errors do not add up along a row.
+#define AGKPOP_WARP_BLOCK 64
+
+// Rows per parallel task and the smallest image worth splitting up
+static const size_t kAGKPOPWarpRowsPerBand = 32;
+static const size_t kAGKPOPWarpMinParallelPixels = 256 * 256;
+
+// Bytes per pixel of AGKPOPWarpBitmap, the other formats go through AGKPOPWarpBuffers
+static const size_t kAGKPOPWarpBytesPerPixel = 4;
+static const size_t kAGKPOPWarpMaxLevels = 16;
+
+// Projective needs a division per pixel. Affine has a constant w, so the
+// coordinates are stepped without dividing. An integer translation with unit
+// scale copies whole runs of source pixels.
+typedef enum AGKPOPWarpKind {
+    AGKPOPWarpKindProjective,
+    AGKPOPWarpKindAffine,
+    AGKPOPWarpKindTranslation,
+} AGKPOPWarpKind;
+
+typedef struct AGKPOPWarpContext {
+    const AGKPOPWarpBitmap *levels; // levels[0] is the source
+    size_t levelCount;
+    const AGKPOPWarpBitmap *destination;
+    const double *matrix;
+    AGKPOPWarpFilter filter;
+    AGKPOPWarpKind kind;
+    ptrdiff_t translationX;
+    ptrdiff_t translationY;
+
+    // Interleaved 8-bit channels per pixel (1, 2 or 4) and the value written
+    // where the destination maps outside the source
+    size_t channels;
+    uint8_t fill;
+
+    // When tiled, levels[0] and destination are regions of larger images. The
+    // matrix and the bounds test always work on the whole images.
+    size_t sourceWidth;
+    size_t sourceHeight;
+    size_t sourceX;
+    size_t sourceY;
+    size_t destinationX;
+    size_t destinationY;
+} AGKPOPWarpContext;
+
+static void AGKPOPWarpCoordinates(double X, double Y, double W,
+                                  double dX, double dY, double dW,
+                                  size_t count, double *sx, double *sy)
+{
+    size_t i = 0;
+
+#if AGKPOP_WARP_SSE2
+    __m128d x = _mm_set_pd(X + dX, X);
+    __m128d y = _mm_set_pd(Y + dY, Y);
+    __m128d w = _mm_set_pd(W + dW, W);
+    __m128d stepX = _mm_set1_pd(2 * dX);
+    __m128d stepY = _mm_set1_pd(2 * dY);
+    __m128d stepW = _mm_set1_pd(2 * dW);
+    __m128d one = _mm_set1_pd(1.0);
+    for(; i + 2 <= count; i += 2)
+    {
+        __m128d invW = _mm_div_pd(one, w);
+        _mm_storeu_pd(sx + i, _mm_mul_pd(x, invW));
+        _mm_storeu_pd(sy + i, _mm_mul_pd(y, invW));
+        x = _mm_add_pd(x, stepX);
+        y = _mm_add_pd(y, stepY);
+        w = _mm_add_pd(w, stepW);
+    }
+    X += dX * i;
+    Y += dY * i;
+    W += dW * i;
+#elif AGKPOP_WARP_NEON
+    double lanesX[2] = {X, X + dX};
+    double lanesY[2] = {Y, Y + dY};
+    double lanesW[2] = {W, W + dW};
+    float64x2_t x = vld1q_f64(lanesX);
+    float64x2_t y = vld1q_f64(lanesY);
+    float64x2_t w = vld1q_f64(lanesW);
+    float64x2_t stepX = vdupq_n_f64(2 * dX);
+    float64x2_t stepY = vdupq_n_f64(2 * dY);
+    float64x2_t stepW = vdupq_n_f64(2 * dW);
+    for(; i + 2 <= count; i += 2)
+    {
+        float64x2_t invW = vdivq_f64(vdupq_n_f64(1.0), w);
+        vst1q_f64(sx + i, vmulq_f64(x, invW));
+        vst1q_f64(sy + i, vmulq_f64(y, invW));
+        x = vaddq_f64(x, stepX);
+        y = vaddq_f64(y, stepY);
+        w = vaddq_f64(w, stepW);
+    }
+    X += dX * i;
+    Y += dY * i;
+    W += dW * i;
+#endif
+
+    for(; i < count; i++)
+    {
+        double invW = 1.0 / W;
+        sx[i] = X * invW;
+        sy[i] = Y * invW;
+        X += dX;
+        Y += dY;
+        W += dW;
+    }
+}
+
+// AGKPOPWarpCoordinates for a constant w. Steps the same way and multiplies by
+// the same reciprocal, so the coordinates are identical, just without dividing.
+static void AGKPOPWarpAffineCoordinates(double X, double Y, double invW,
+                                        double dX, double dY,
+                                        size_t count, double *sx, double *sy)
+{
+    size_t i = 0;
+
+#if AGKPOP_WARP_SSE2
+    __m128d x = _mm_set_pd(X + dX, X);
+    __m128d y = _mm_set_pd(Y + dY, Y);
+    __m128d scale = _mm_set1_pd(invW);
+    __m128d stepX = _mm_set1_pd(2 * dX);
+    __m128d stepY = _mm_set1_pd(2 * dY);
+    for(; i + 2 <= count; i += 2)
+    {
+        _mm_storeu_pd(sx + i, _mm_mul_pd(x, scale));
+        _mm_storeu_pd(sy + i, _mm_mul_pd(y, scale));
+        x = _mm_add_pd(x, stepX);
+        y = _mm_add_pd(y, stepY);
+    }
+    X += dX * i;
+    Y += dY * i;
+#elif AGKPOP_WARP_NEON
+    double lanesX[2] = {X, X + dX};
+    double lanesY[2] = {Y, Y + dY};
+    float64x2_t x = vld1q_f64(lanesX);
+    float64x2_t y = vld1q_f64(lanesY);
+    float64x2_t scale = vdupq_n_f64(invW);
+    float64x2_t stepX = vdupq_n_f64(2 * dX);
+    float64x2_t stepY = vdupq_n_f64(2 * dY);
+    for(; i + 2 <= count; i += 2)
+    {
+        vst1q_f64(sx + i, vmulq_f64(x, scale));
+        vst1q_f64(sy + i, vmulq_f64(y, scale));
+        x = vaddq_f64(x, stepX);
+        y = vaddq_f64(y, stepY);
+    }
+    X += dX * i;
+    Y += dY * i;
+#endif
+
+    for(; i < count; i++)
+    {
+        sx[i] = X * invW;
+        sy[i] = Y * invW;
+        X += dX;
+        Y += dY;
+    }
+}
+
+static inline size_t AGKPOPWarpClamp(ptrdiff_t value, size_t count)
+{
+    if(value < 0)
+    {
+        return 0;
+    }
+    return (size_t)value < count ? (size_t)value : count - 1;
+}
+
+static inline const uint8_t *AGKPOPWarpPixel(const AGKPOPWarpBitmap *bitmap, size_t x, size_t y, size_t channels)
+{
+    return bitmap->data + y * bitmap->bytesPerRow + x * channels;
+}
+
+// The samplers take the position in the whole source and the origin of the
+// bitmap in it, so that a tile is sampled exactly like the whole source. They
+// are always called with a constant channel count so each count gets its own
+// specialized copy.
+static inline void AGKPOPWarpSampleNearest(const AGKPOPWarpBitmap *bitmap, ptrdiff_t ox, ptrdiff_t oy,
+                                           double sx, double sy, uint8_t *out, size_t channels)
+{
+    size_t x = AGKPOPWarpClamp((ptrdiff_t)sx - ox, bitmap->width);
+    size_t y = AGKPOPWarpClamp((ptrdiff_t)sy - oy, bitmap->height);
+    memcpy(out, AGKPOPWarpPixel(bitmap, x, y, channels), channels);
+}
+
+static inline void AGKPOPWarpSampleBilinear(const AGKPOPWarpBitmap *bitmap, ptrdiff_t ox, ptrdiff_t oy,
+                                            double sx, double sy, uint8_t *out, size_t channels)
+{
+    double u = sx - 0.5;
+    double v = sy - 0.5;
+    double fu = floor(u);
+    double fv = floor(v);
+
+    // 8 bit fixed point weights
+    uint32_t wx = (uint32_t)((u - fu) * 256.0);
+    uint32_t wy = (uint32_t)((v - fv) * 256.0);
+
+    ptrdiff_t x = (ptrdiff_t)fu - ox;
+    ptrdiff_t y = (ptrdiff_t)fv - oy;
+    size_t x0 = AGKPOPWarpClamp(x, bitmap->width);
+    size_t x1 = AGKPOPWarpClamp(x + 1, bitmap->width);
+    size_t y0 = AGKPOPWarpClamp(y, bitmap->height);
+    size_t y1 = AGKPOPWarpClamp(y + 1, bitmap->height);
+
+    const uint8_t *p00 = AGKPOPWarpPixel(bitmap, x0, y0, channels);
+    const uint8_t *p01 = AGKPOPWarpPixel(bitmap, x1, y0, channels);
+    const uint8_t *p10 = AGKPOPWarpPixel(bitmap, x0, y1, channels);
+    const uint8_t *p11 = AGKPOPWarpPixel(bitmap, x1, y1, channels);
+
+    for(size_t c = 0; c < channels; c++)
+    {
+        uint32_t top = p00[c] * (256 - wx) + p01[c] * wx;
+        uint32_t bottom = p10[c] * (256 - wx) + p11[c] * wx;
+        out[c] = (uint8_t)((top * (256 - wy) + bottom * wy + 32768) >> 16);
+    }
+}
+
+static inline void AGKPOPWarpCubicWeights(double t, float *w)
+{
+    // Catmull-Rom
+    w[0] = (float)(((-0.5 * t + 1.0) * t - 0.5) * t);
+    w[1] = (float)((1.5 * t - 2.5) * t * t + 1.0);
+    w[2] = (float)(((-1.5 * t + 2.0) * t + 0.5) * t);
+    w[3] = (float)((0.5 * t - 0.5) * t * t);
+}
+
+static inline void AGKPOPWarpSampleBicubic(const AGKPOPWarpBitmap *bitmap, ptrdiff_t ox, ptrdiff_t oy,
+                                           double sx, double sy, uint8_t *out, size_t channels)
+{
+    double u = sx - 0.5;
+    double v = sy - 0.5;
+    double fu = floor(u);
+    double fv = floor(v);
+
+    float wx[4];
+    float wy[4];
+    AGKPOPWarpCubicWeights(u - fu, wx);
+    AGKPOPWarpCubicWeights(v - fv, wy);
+
+    size_t xs[4];
+    ptrdiff_t x = (ptrdiff_t)fu - 1 - ox;
+    ptrdiff_t y = (ptrdiff_t)fv - 1 - oy;
+    for(int i = 0; i < 4; i++)
+    {
+        xs[i] = AGKPOPWarpClamp(x + i, bitmap->width);
+    }
+
+    float sum[4] = {0, 0, 0, 0};
+    for(int j = 0; j < 4; j++)
+    {
+        const uint8_t *row = bitmap->data + AGKPOPWarpClamp(y + j, bitmap->height) * bitmap->bytesPerRow;
+        float rowSum[4] = {0, 0, 0, 0};
+        for(int i = 0; i < 4; i++)
+        {
+            const uint8_t *p = row + xs[i] * channels;
+            if(channels == 4)
+            {
+                // Spelled out, compilers vectorize the loop below poorly for this case
+                rowSum[0] += p[0] * wx[i];
+                rowSum[1] += p[1] * wx[i];
+                rowSum[2] += p[2] * wx[i];
+                rowSum[3] += p[3] * wx[i];
+            }
+            else
+            {
+                for(size_t c = 0; c < channels; c++)
+                {
+                    rowSum[c] += p[c] * wx[i];
+                }
+            }
+        }
+        for(size_t c = 0; c < channels; c++)
+        {
+            sum[c] += rowSum[c] * wy[j];
+        }
+    }
+
+    // Catmull-Rom overshoots, keep the result in range and, with alpha, a
+    // valid premultiplied color
+    if(channels != 4)
+    {
+        for(size_t c = 0; c < channels; c++)
+        {
+            float value = sum[c] < 0.0f ? 0.0f : (sum[c] > 255.0f ? 255.0f : sum[c]);
+            out[c] = (uint8_t)(value + 0.5f);
+        }
+        return;
+    }
+    float alpha = sum[3] < 0.0f ? 0.0f : (sum[3] > 255.0f ? 255.0f : sum[3]);
+    out[3] = (uint8_t)(alpha + 0.5f);
+    for(int c = 0; c < 3; c++)
+    {
+        float value = sum[c] < 0.0f ? 0.0f : (sum[c] > alpha ? alpha : sum[c]);
+        out[c] = (uint8_t)(value + 0.5f);
+    }
+}
+
+// Mipmap level for the source footprint of one destination pixel at (x, y)
+static size_t AGKPOPWarpLevel(const AGKPOPWarpContext *context, double x, double y)
+{
+    if(context->levelCount < 2)
+    {
+        return 0;
+    }
+
+    const double *m = context->matrix;
+    double W = m[6] * x + m[7] * y + m[8];
+    if(W == 0.0)
+    {
+        return 0;
+    }
+    double sx = (m[0] * x + m[1] * y + m[2]) / W;
+    double sy = (m[3] * x + m[4] * y + m[5]) / W;
+
+    // Jacobian of the projection
+    double a = (m[0] - sx * m[6]) / W;
+    double b = (m[1] - sx * m[7]) / W;
+    double c = (m[3] - sy * m[6]) / W;
+    double d = (m[4] - sy * m[7]) / W;
+    double footprint = fmax(a * a + c * c, b * b + d * d);
+    if(!(footprint >= 4.0))
+    {
+        return 0;
+    }
+
+    size_t level = (size_t)(0.5 * log2(footprint));
+    return level < context->levelCount ? level : context->levelCount - 1;
+}
+
+static inline void AGKPOPWarpBlock(const AGKPOPWarpContext *context, const AGKPOPWarpBitmap *bitmap,
+                                   ptrdiff_t ox, ptrdiff_t oy, double levelScale,
+                                   const double *sx, const double *sy, size_t count, uint8_t *pixel, size_t channels)
+{
+    const double width = (double)context->sourceWidth;
+    const double height = (double)context->sourceHeight;
+
+    for(size_t i = 0; i < count; i++, pixel += channels)
+    {
+        // Written so that NaN coordinates count as outside
+        if(!(sx[i] >= 0 && sx[i] < width && sy[i] >= 0 && sy[i] < height))
+        {
+            memset(pixel, context->fill, channels);
+            continue;
+        }
+
+        double u = sx[i] * levelScale;
+        double v = sy[i] * levelScale;
+        switch(context->filter)
+        {
+            case AGKPOPWarpFilterBilinear:
+                AGKPOPWarpSampleBilinear(bitmap, ox, oy, u, v, pixel, channels);
+                break;
+            case AGKPOPWarpFilterBicubic:
+                AGKPOPWarpSampleBicubic(bitmap, ox, oy, u, v, pixel, channels);
+                break;
+            case AGKPOPWarpFilterNearest:
+            default:
+                AGKPOPWarpSampleNearest(bitmap, ox, oy, u, v, pixel, channels);
+                break;
+        }
+    }
+}
+
+// Narrows [*lo, *hi] to where a * t + b >= 0
+static inline void AGKPOPWarpClipLinear(double a, double b, double *lo, double *hi)
+{
+    if(a > 0.0)
+    {
+        *lo = fmax(*lo, -b / a);
+    }
+    else if(a < 0.0)
+    {
+        *hi = fmin(*hi, -b / a);
+    }
+    else if(!(b >= 0.0))
+    {
+        *lo = INFINITY;
+    }
+}
+
+// The destination pixels of a row whose projection can land inside the source,
+// as up to two spans [start, end) in spans[2 * i], spans[2 * i + 1]. Along the
+// row X, Y and W are linear in x, so on either side of where W changes sign
+// each edge of the source is a linear inequality in x. Spans are widened by a
+// pixel for rounding, the exact test is still done per pixel inside them.
+static size_t AGKPOPWarpRowSpans(const AGKPOPWarpContext *context, double y, double center, size_t spans[4])
+{
+    const double *m = context->matrix;
+    const double width = (double)context->sourceWidth;
+    const double height = (double)context->sourceHeight;
+    const double offset = (double)context->destinationX + center;
+    const double pixels = (double)context->destination->width;
+
+    // X(t) = aX * t + bX and so on, with t the index of the pixel in the row
+    const double aX = m[0], bX = m[0] * offset + m[1] * y + m[2];
+    const double aY = m[3], bY = m[3] * offset + m[4] * y + m[5];
+    const double aW = m[6], bW = m[6] * offset + m[7] * y + m[8];
+
+    double lows[2] = {-INFINITY, -INFINITY};
+    double highs[2] = {INFINITY, INFINITY};
+    double signs[2];
+    size_t domains = 1;
+    if(aW == 0.0)
+    {
+        signs[0] = bW > 0.0 ? 1.0 : -1.0;
+        if(bW == 0.0)
+        {
+            lows[0] = INFINITY;
+        }
+    }
+    else
+    {
+        double t = -bW / aW;
+        highs[0] = t;
+        lows[1] = t;
+        signs[0] = aW > 0.0 ? -1.0 : 1.0;
+        signs[1] = -signs[0];
+        domains = 2;
+    }
+
+    size_t count = 0;
+    for(size_t i = 0; i < domains; i++)
+    {
+        // With s the sign of W: 0 <= X / W < width is s * X >= 0 and s * (width * W - X) > 0
+        double s = signs[i];
+        double lo = lows[i];
+        double hi = highs[i];
+        AGKPOPWarpClipLinear(s * aX, s * bX, &lo, &hi);
+        AGKPOPWarpClipLinear(s * (width * aW - aX), s * (width * bW - bX), &lo, &hi);
+        AGKPOPWarpClipLinear(s * aY, s * bY, &lo, &hi);
+        AGKPOPWarpClipLinear(s * (height * aW - aY), s * (height * bW - bY), &lo, &hi);
+
+        if(isnan(lo) || isnan(hi))
+        {
+            lo = 0.0;
+            hi = pixels;
+        }
+        lo = fmax(floor(lo) - 1.0, 0.0);
+        hi = fmin(ceil(hi) + 2.0, pixels);
+        if(!(lo < hi))
+        {
+            continue;
+        }
+
+        size_t start = (size_t)lo;
+        size_t end = (size_t)hi;
+        if(count > 0 && start <= spans[2 * count - 1])
+        {
+            spans[2 * count - 1] = end > spans[2 * count - 1] ? end : spans[2 * count - 1];
+            continue;
+        }
+        spans[2 * count] = start;
+        spans[2 * count + 1] = end;
+        count++;
+    }
+    return count;
+}
+
+static void AGKPOPWarpSpan(const AGKPOPWarpContext *context, double y, double center, uint8_t *out,
+                           size_t start, size_t end)
+{
+    double sx[AGKPOP_WARP_BLOCK];
+    double sy[AGKPOP_WARP_BLOCK];
+    const double *m = context->matrix;
+
+    for(size_t x0 = start; x0 < end; x0 += AGKPOP_WARP_BLOCK)
+    {
+        size_t count = end - x0;
+        if(count > AGKPOP_WARP_BLOCK)
+        {
+            count = AGKPOP_WARP_BLOCK;
+        }
+
+        double x = (double)(context->destinationX + x0) + center;
+        if(context->kind == AGKPOPWarpKindProjective)
+        {
+            AGKPOPWarpCoordinates(m[0] * x + m[1] * y + m[2],
+                                  m[3] * x + m[4] * y + m[5],
+                                  m[6] * x + m[7] * y + m[8],
+                                  m[0], m[3], m[6],
+                                  count, sx, sy);
+        }
+        else
+        {
+            AGKPOPWarpAffineCoordinates(m[0] * x + m[1] * y + m[2],
+                                        m[3] * x + m[4] * y + m[5],
+                                        1.0 / m[8],
+                                        m[0], m[3],
+                                        count, sx, sy);
+        }
+
+        size_t level = AGKPOPWarpLevel(context, x + 0.5 * count, y);
+        const AGKPOPWarpBitmap *bitmap = &context->levels[level];
+        double levelScale = 1.0 / (double)((size_t)1 << level);
+        ptrdiff_t ox = level == 0 ? (ptrdiff_t)context->sourceX : 0;
+        ptrdiff_t oy = level == 0 ? (ptrdiff_t)context->sourceY : 0;
+
+        uint8_t *pixel = out + x0 * context->channels;
+        switch(context->channels)
+        {
+            case 1:
+                AGKPOPWarpBlock(context, bitmap, ox, oy, levelScale, sx, sy, count, pixel, 1);
+                break;
+            case 2:
+                AGKPOPWarpBlock(context, bitmap, ox, oy, levelScale, sx, sy, count, pixel, 2);
+                break;
+            default:
+                AGKPOPWarpBlock(context, bitmap, ox, oy, levelScale, sx, sy, count, pixel, 4);
+                break;
+        }
+    }
+}
+
+// Source and destination pixels line up, so rows are copied. Sampling a pixel
+// center with any of the filters returns that pixel unchanged.
+static void AGKPOPWarpTranslatedRow(const AGKPOPWarpContext *context, size_t row)
+{
+    const AGKPOPWarpBitmap *destination = context->destination;
+    const AGKPOPWarpBitmap *source = &context->levels[0];
+    const size_t channels = context->channels;
+    uint8_t *out = destination->data + row * destination->bytesPerRow;
+
+    // Where the row starts in the whole source, and the part of it that is inside
+    ptrdiff_t sy = (ptrdiff_t)(context->destinationY + row) + context->translationY;
+    ptrdiff_t sx = (ptrdiff_t)context->destinationX + context->translationX;
+    ptrdiff_t start = sx < 0 ? -sx : 0;
+    ptrdiff_t end = (ptrdiff_t)context->sourceWidth - sx;
+    if(end > (ptrdiff_t)destination->width)
+    {
+        end = (ptrdiff_t)destination->width;
+    }
+    if(sy < 0 || sy >= (ptrdiff_t)context->sourceHeight || start >= end)
+    {
+        memset(out, context->fill, destination->width * channels);
+        return;
+    }
+
+    const uint8_t *in = source->data + (size_t)(sy - (ptrdiff_t)context->sourceY) * source->bytesPerRow;
+    in += (size_t)(sx + start - (ptrdiff_t)context->sourceX) * channels;
+    memset(out, context->fill, (size_t)start * channels);
+    memcpy(out + start * channels, in, (size_t)(end - start) * channels);
+    memset(out + end * channels, context->fill, (destination->width - (size_t)end) * channels);
+}
+
+static void AGKPOPWarpRow(const AGKPOPWarpContext *context, size_t row)
+{
+    if(context->kind == AGKPOPWarpKindTranslation)
+    {
+        AGKPOPWarpTranslatedRow(context, row);
+        return;
+    }
+
+    const AGKPOPWarpBitmap *destination = context->destination;
+    const size_t channels = context->channels;
+    // Filtered samples are taken at pixel centers, nearest keeps the plain
+    // pixel index so that it matches the truncating mapping used so far
+    const double center = context->filter == AGKPOPWarpFilterNearest ? 0.0 : 0.5;
+    const double y = (double)(context->destinationY + row) + center;
+    uint8_t *out = destination->data + row * destination->bytesPerRow;
+
+    // Pixels outside the spans map outside the source and are cleared at once
+    size_t spans[4];
+    size_t spanCount = AGKPOPWarpRowSpans(context, y, center, spans);
+    size_t filled = 0;
+    for(size_t span = 0; span < spanCount; span++)
+    {
+        memset(out + filled * channels, context->fill, (spans[2 * span] - filled) * channels);
+        filled = spans[2 * span + 1];
+        AGKPOPWarpSpan(context, y, center, out, spans[2 * span], filled);
+    }
+    memset(out + filled * channels, context->fill, (destination->width - filled) * channels);
+}
+
+static void AGKPOPWarpContextRows(const AGKPOPWarpContext *context, size_t firstRow, size_t lastRow)
+{
+    if(lastRow > context->destination->height)
+    {
+        lastRow = context->destination->height;
+    }
+
+    for(size_t row = firstRow; row < lastRow; row++)
+    {
+        AGKPOPWarpRow(context, row);
+    }
+}
+
+static AGKPOPWarpKind AGKPOPWarpClassify(const double m[9], ptrdiff_t *translationX, ptrdiff_t *translationY)
+{
+    if(m[6] != 0.0 || m[7] != 0.0 || m[8] == 0.0)
+    {
+        return AGKPOPWarpKindProjective;
+    }
+
+    // Only with w exactly one do the sampled positions land exactly on pixels
+    const double limit = 1 << 30;
+    if(m[0] == 1.0 && m[1] == 0.0 && m[3] == 0.0 && m[4] == 1.0 && m[8] == 1.0 &&
+       m[2] == floor(m[2]) && m[5] == floor(m[5]) && fabs(m[2]) < limit && fabs(m[5]) < limit)
+    {
+        *translationX = (ptrdiff_t)m[2];
+        *translationY = (ptrdiff_t)m[5];
+        return AGKPOPWarpKindTranslation;
+    }
+    return AGKPOPWarpKindAffine;
+}
+
+static void AGKPOPWarpContextInit(AGKPOPWarpContext *context, const AGKPOPWarpBitmap *levels,
+                                  const AGKPOPWarpBitmap *destination, const double matrix[9],
+                                  const AGKPOPWarpOptions *options)
+{
+    context->levels = levels;
+    context->levelCount = 1;
+    context->destination = destination;
+    context->matrix = matrix;
+    context->filter = options ? options->filter : AGKPOPWarpFilterNearest;
+    context->translationX = 0;
+    context->translationY = 0;
+    context->kind = AGKPOPWarpClassify(matrix, &context->translationX, &context->translationY);
+    context->channels = kAGKPOPWarpBytesPerPixel;
+    context->fill = 0;
+    context->sourceWidth = levels[0].width;
+    context->sourceHeight = levels[0].height;
+    context->sourceX = 0;
+    context->sourceY = 0;
+    context->destinationX = 0;
+    context->destinationY = 0;
+}
+
+void AGKPOPWarpRows(const AGKPOPWarpBitmap *source, const AGKPOPWarpBitmap *destination, const double matrix[9],
+                    const AGKPOPWarpOptions *options, size_t firstRow, size_t lastRow)
+{
+    AGKPOPWarpContext context;
+    AGKPOPWarpContextInit(&context, source, destination, matrix, options);
+    AGKPOPWarpContextRows(&context, firstRow, lastRow);
+}
+
+// Halves the previous level with a 2x2 box filter, which is exact for
+// premultiplied colors. Returns the number of levels including the source.
+static size_t AGKPOPWarpBuildLevels(const AGKPOPWarpBitmap *source, size_t channels, AGKPOPWarpBitmap *levels, size_t maxLevels)
+{
+    levels[0] = *source;
+    size_t count = 1;
+
+    while(count < maxLevels)
+    {
+        const AGKPOPWarpBitmap *previous = &levels[count - 1];
+        if(previous->width < 2 || previous->height < 2)
+        {
+            break;
+        }
+
+        AGKPOPWarpBitmap *level = &levels[count];
+        level->width = previous->width / 2;
+        level->height = previous->height / 2;
+        level->bytesPerRow = level->width * channels;
+        level->data = AGKPOPBufferPoolAcquire(AGKPOPBufferPoolShared(), level->height * level->bytesPerRow);
+        if(level->data == NULL)
+        {
+            break;
+        }
+
+        for(size_t y = 0; y < level->height; y++)
+        {
+            const uint8_t *top = previous->data + 2 * y * previous->bytesPerRow;
+            const uint8_t *bottom = top + previous->bytesPerRow;
+            uint8_t *out = level->data + y * level->bytesPerRow;
+            for(size_t x = 0; x < level->width; x++)
+            {
+                for(size_t c = 0; c < channels; c++)
+                {
+                    size_t i = 2 * x * channels + c;
+                    out[x * channels + c] = (uint8_t)((top[i] + top[i + channels] +
+                                                       bottom[i] + bottom[i + channels] + 2) >> 2);
+                }
+            }
+        }
+        count++;
+    }
+
+    return count;
+}
+
+static void AGKPOPWarpBand(void *context, size_t band)
+{
+    size_t firstRow = band * kAGKPOPWarpRowsPerBand;
+    AGKPOPWarpContextRows(context, firstRow, firstRow + kAGKPOPWarpRowsPerBand);
+}
+
+static void AGKPOPWarpParallel(const AGKPOPWarpContext *context)
+{
+    const AGKPOPWarpBitmap *destination = context->destination;
+    size_t bandCount = (destination->height + kAGKPOPWarpRowsPerBand - 1) / kAGKPOPWarpRowsPerBand;
+
+    if(bandCount < 2 || destination->width * destination->height < kAGKPOPWarpMinParallelPixels)
+    {
+        AGKPOPWarpContextRows(context, 0, destination->height);
+        return;
+    }
+
+    AGKPOPParallelApply(bandCount, (void *)context, AGKPOPWarpBand);
+}
+
+static void AGKPOPWarpChannels(const AGKPOPWarpBitmap *source, const AGKPOPWarpBitmap *destination, const double matrix[9],
+                               const AGKPOPWarpOptions *options, size_t channels, uint8_t fill)
+{
+    AGKPOPWarpBitmap levels[kAGKPOPWarpMaxLevels];
+    levels[0] = *source;
+
+    AGKPOPWarpContext context;
+    AGKPOPWarpContextInit(&context, levels, destination, matrix, options);
+    context.channels = channels;
+    context.fill = fill;
+
+    // A translation never minifies
+    if(options && options->mipmaps && context.kind != AGKPOPWarpKindTranslation)
+    {
+        context.levelCount = AGKPOPWarpBuildLevels(source, channels, levels, kAGKPOPWarpMaxLevels);
+    }
+
+    AGKPOPWarpParallel(&context);
+
+    for(size_t level = 1; level < context.levelCount; level++)
+    {
+        AGKPOPBufferPoolRelease(AGKPOPBufferPoolShared(), levels[level].data);
+    }
+}
+
+void AGKPOPWarp(const AGKPOPWarpBitmap *source, const AGKPOPWarpBitmap *destination, const double matrix[9],
+                const AGKPOPWarpOptions *options)
+{
+    AGKPOPWarpChannels(source, destination, matrix, options, kAGKPOPWarpBytesPerPixel, 0);
+}
+
+static AGKPOPWarpBitmap AGKPOPWarpBufferBitmap(const AGKPOPWarpBuffer *buffer, size_t plane, size_t subsampling)
+{
+    AGKPOPWarpBitmap bitmap;
+    bitmap.data = buffer->planes[plane].data;
+    bitmap.width = (buffer->width + subsampling - 1) / subsampling;
+    bitmap.height = (buffer->height + subsampling - 1) / subsampling;
+    bitmap.bytesPerRow = buffer->planes[plane].bytesPerRow;
+    return bitmap;
+}
+
+bool AGKPOPWarpBuffers(const AGKPOPWarpBuffer *source, const AGKPOPWarpBuffer *destination, const double matrix[9],
+                       const AGKPOPWarpOptions *options)
+{
+    if(source->format != destination->format)
+    {
+        return false;
+    }
+
+    AGKPOPWarpBitmap from = AGKPOPWarpBufferBitmap(source, 0, 1);
+    AGKPOPWarpBitmap to = AGKPOPWarpBufferBitmap(destination, 0, 1);
+    switch(source->format)
+    {
+        case AGKPOPWarpPixelFormatRGBA8:
+        case AGKPOPWarpPixelFormatBGRA8:
+            // Alpha is last in both, the channel order does not matter otherwise
+            AGKPOPWarpChannels(&from, &to, matrix, options, 4, 0);
+            return true;
+
+        case AGKPOPWarpPixelFormatGray8:
+            AGKPOPWarpChannels(&from, &to, matrix, options, 1, 0);
+            return true;
+
+        case AGKPOPWarpPixelFormatYUV420:
+        case AGKPOPWarpPixelFormatYUV420BiPlanar:
+            break;
+
+        default:
+            return false;
+    }
+
+    AGKPOPWarpChannels(&from, &to, matrix, options, 1, 0);
+
+    // Chroma planes are warped at their own resolution: scale up to luma
+    // coordinates, map, and scale back down
+    double chroma[9] = {
+        matrix[0],       matrix[1],       matrix[2] * 0.5,
+        matrix[3],       matrix[4],       matrix[5] * 0.5,
+        matrix[6] * 2.0, matrix[7] * 2.0, matrix[8],
+    };
+
+    // Neutral chroma outside the source, so the border is black and not green
+    const uint8_t fill = 128;
+    if(source->format == AGKPOPWarpPixelFormatYUV420BiPlanar)
+    {
+        from = AGKPOPWarpBufferBitmap(source, 1, 2);
+        to = AGKPOPWarpBufferBitmap(destination, 1, 2);
+        AGKPOPWarpChannels(&from, &to, chroma, options, 2, fill);
+        return true;
+    }
+
+    for(size_t plane = 1; plane < 3; plane++)
+    {
+        from = AGKPOPWarpBufferBitmap(source, plane, 2);
+        to = AGKPOPWarpBufferBitmap(destination, plane, 2);
+        AGKPOPWarpChannels(&from, &to, chroma, options, 1, fill);
+    }
+    return true;
+}
+
+static const size_t kAGKPOPWarpDefaultTileSize = 256;
+static const size_t kAGKPOPWarpDefaultMaxSourceTileBytes = 4 * 1024 * 1024;
+
+// Extra source pixels around the footprint, enough for the 4x4 bicubic kernel
+static const double kAGKPOPWarpTileMargin = 2.0;
+
+typedef enum AGKPOPWarpFootprint {
+    AGKPOPWarpFootprintEmpty,
+    AGKPOPWarpFootprintBounded,
+    AGKPOPWarpFootprintSplit,
+} AGKPOPWarpFootprint;
+
+typedef struct AGKPOPWarpTiledState {
+    const AGKPOPWarpTiling *tiling;
+    const double *matrix;
+    const AGKPOPWarpOptions *options;
+    double center;
+    size_t maxSourceTileBytes;
+
+    AGKPOPWarpBitmap destinationTile;
+    size_t tileX;
+    size_t tileY;
+
+    uint8_t *sourceData;
+    size_t sourceCapacity;
+} AGKPOPWarpTiledState;
+
+// Source pixels needed by the destination pixels [x0, x1] x [y0, y1]. As long
+// as w has the same sign in all four corners the projection of the region is
+// the convex hull of the projected corners, otherwise the region straddles the
+// horizon and has to be split.
+static AGKPOPWarpFootprint AGKPOPWarpTileFootprint(const AGKPOPWarpTiledState *state,
+                                                   size_t x0, size_t y0, size_t x1, size_t y1,
+                                                   size_t *sourceRect)
+{
+    const double *m = state->matrix;
+    const double xs[2] = {(double)x0 + state->center, (double)x1 + state->center};
+    const double ys[2] = {(double)y0 + state->center, (double)y1 + state->center};
+
+    int positive = 0;
+    int negative = 0;
+    double minX = INFINITY, minY = INFINITY, maxX = -INFINITY, maxY = -INFINITY;
+    for(int j = 0; j < 2; j++)
+    {
+        for(int i = 0; i < 2; i++)
+        {
+            double W = m[6] * xs[i] + m[7] * ys[j] + m[8];
+            positive += W > 0.0;
+            negative += W < 0.0;
+            double sx = (m[0] * xs[i] + m[1] * ys[j] + m[2]) / W;
+            double sy = (m[3] * xs[i] + m[4] * ys[j] + m[5]) / W;
+            minX = fmin(minX, sx);
+            maxX = fmax(maxX, sx);
+            minY = fmin(minY, sy);
+            maxY = fmax(maxY, sy);
+        }
+    }
+
+    if(positive != 4 && negative != 4)
+    {
+        return x0 == x1 && y0 == y1 ? AGKPOPWarpFootprintEmpty : AGKPOPWarpFootprintSplit;
+    }
+
+    const double width = (double)state->tiling->sourceWidth;
+    const double height = (double)state->tiling->sourceHeight;
+    double left = fmax(floor(minX) - kAGKPOPWarpTileMargin, 0.0);
+    double top = fmax(floor(minY) - kAGKPOPWarpTileMargin, 0.0);
+    double right = fmin(floor(maxX) + kAGKPOPWarpTileMargin + 1.0, width);
+    double bottom = fmin(floor(maxY) + kAGKPOPWarpTileMargin + 1.0, height);
+
+    // Written so that NaN counts as empty
+    if(!(left < right && top < bottom))
+    {
+        return AGKPOPWarpFootprintEmpty;
+    }
+
+    sourceRect[0] = (size_t)left;
+    sourceRect[1] = (size_t)top;
+    sourceRect[2] = (size_t)right - sourceRect[0];
+    sourceRect[3] = (size_t)bottom - sourceRect[1];
+    if(sourceRect[2] * sourceRect[3] * kAGKPOPWarpBytesPerPixel > state->maxSourceTileBytes && (x0 != x1 || y0 != y1))
+    {
+        return AGKPOPWarpFootprintSplit;
+    }
+    return AGKPOPWarpFootprintBounded;
+}
+
+static bool AGKPOPWarpTiledRegion(AGKPOPWarpTiledState *state, size_t x, size_t y, size_t width, size_t height)
+{
+    const AGKPOPWarpBitmap *tile = &state->destinationTile;
+    AGKPOPWarpBitmap region;
+    region.data = tile->data + (y - state->tileY) * tile->bytesPerRow + (x - state->tileX) * kAGKPOPWarpBytesPerPixel;
+    region.width = width;
+    region.height = height;
+    region.bytesPerRow = tile->bytesPerRow;
+
+    size_t rect[4];
+    switch(AGKPOPWarpTileFootprint(state, x, y, x + width - 1, y + height - 1, rect))
+    {
+        case AGKPOPWarpFootprintEmpty:
+            for(size_t row = 0; row < height; row++)
+            {
+                memset(region.data + row * region.bytesPerRow, 0, width * kAGKPOPWarpBytesPerPixel);
+            }
+            return true;
+
+        case AGKPOPWarpFootprintSplit:
+            if(width >= height)
+            {
+                size_t half = width / 2;
+                return AGKPOPWarpTiledRegion(state, x, y, half, height) &&
+                       AGKPOPWarpTiledRegion(state, x + half, y, width - half, height);
+            }
+            else
+            {
+                size_t half = height / 2;
+                return AGKPOPWarpTiledRegion(state, x, y, width, half) &&
+                       AGKPOPWarpTiledRegion(state, x, y + half, width, height - half);
+            }
+
+        case AGKPOPWarpFootprintBounded:
+        default:
+            break;
+    }
+
+    AGKPOPWarpBitmap source;
+    source.width = rect[2];
+    source.height = rect[3];
+    source.bytesPerRow = source.width * kAGKPOPWarpBytesPerPixel;
+    size_t size = source.height * source.bytesPerRow;
+    if(size > state->sourceCapacity)
+    {
+        // The old contents are not needed, so there is nothing to copy over
+        AGKPOPBufferPoolRelease(AGKPOPBufferPoolShared(), state->sourceData);
+        state->sourceData = AGKPOPBufferPoolAcquire(AGKPOPBufferPoolShared(), size);
+        state->sourceCapacity = state->sourceData ? size : 0;
+        if(state->sourceData == NULL)
+        {
+            return false;
+        }
+    }
+    source.data = state->sourceData;
+
+    const AGKPOPWarpTiling *tiling = state->tiling;
+    if(!tiling->read(tiling->context, &source, rect[0], rect[1]))
+    {
+        return false;
+    }
+
+    AGKPOPWarpContext context;
+    AGKPOPWarpContextInit(&context, &source, &region, state->matrix, state->options);
+    context.sourceWidth = tiling->sourceWidth;
+    context.sourceHeight = tiling->sourceHeight;
+    context.sourceX = rect[0];
+    context.sourceY = rect[1];
+    context.destinationX = x;
+    context.destinationY = y;
+    AGKPOPWarpContextRows(&context, 0, height);
+    return true;
+}
+
+bool AGKPOPWarpTiled(const AGKPOPWarpTiling *tiling, const double matrix[9], const AGKPOPWarpOptions *options)
+{
+    size_t tileSize = tiling->tileSize ? tiling->tileSize : kAGKPOPWarpDefaultTileSize;
+
+    AGKPOPWarpTiledState state;
+    state.tiling = tiling;
+    state.matrix = matrix;
+    state.options = options;
+    state.center = options && options->filter != AGKPOPWarpFilterNearest ? 0.5 : 0.0;
+    state.maxSourceTileBytes = tiling->maxSourceTileBytes ? tiling->maxSourceTileBytes : kAGKPOPWarpDefaultMaxSourceTileBytes;
+    state.destinationTile.bytesPerRow = tileSize * kAGKPOPWarpBytesPerPixel;
+    state.destinationTile.data = AGKPOPBufferPoolAcquire(AGKPOPBufferPoolShared(), tileSize * state.destinationTile.bytesPerRow);
+    state.sourceData = NULL;
+    state.sourceCapacity = 0;
+    if(state.destinationTile.data == NULL)
+    {
+        return false;
+    }
+
+    bool success = true;
+    for(size_t y = 0; y < tiling->destinationHeight && success; y += tileSize)
+    {
+        for(size_t x = 0; x < tiling->destinationWidth && success; x += tileSize)
+        {
+            state.tileX = x;
+            state.tileY = y;
+            state.destinationTile.width = tiling->destinationWidth - x < tileSize ? tiling->destinationWidth - x : tileSize;
+            state.destinationTile.height = tiling->destinationHeight - y < tileSize ? tiling->destinationHeight - y : tileSize;
+            success = AGKPOPWarpTiledRegion(&state, x, y, state.destinationTile.width, state.destinationTile.height) &&
+                      tiling->write(tiling->context, &state.destinationTile, x, y);
+        }
+    }
+
+    AGKPOPBufferPoolRelease(AGKPOPBufferPoolShared(), state.destinationTile.data);
+    AGKPOPBufferPoolRelease(AGKPOPBufferPoolShared(), state.sourceData);
+    return success;
+}
@@ -0,0 +1,186 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef AGKPOPWarp_h
+#define AGKPOPWarp_h
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "AGKBaseDefines.h"
+
+AGK_EXTERN_C_BEGIN
+
+/*
+ Perspective warp of 8-bit RGBA bitmaps, a portable replacement for
+ -[AGKTransformPixelMapper mapBitmap:to:...].
+
+ `matrix` is a row major 3x3 homography mapping a destination pixel (x, y) to
+ the source position
+
+     sx = (m[0] * x + m[1] * y + m[2]) / (m[6] * x + m[7] * y + m[8])
+     sy = (m[3] * x + m[4] * y + m[5]) / (m[6] * x + m[7] * y + m[8])
+
+ Along a row the three terms grow by a constant, so every pixel costs three adds
+ and one division instead of re-evaluating the full projection. When m[6] and
+ m[7] are zero (affine) the division is dropped, and an integer translation
+ (m[0] = m[4] = m[8] = 1, m[1] = m[3] = 0) copies rows with memcpy. Both give
+ the same result as the general path. Rows are split into bands warped in
+ parallel on all cores. Destination pixels mapping outside the source are
+ cleared. Every row first solves for the spans of pixels that can land inside
+ the source, everything outside them is cleared with memset without being
+ projected.
+ */
+
+typedef struct AGKPOPWarpBitmap {
+    uint8_t *data;
+    size_t width;
+    size_t height;
+    size_t bytesPerRow;
+} AGKPOPWarpBitmap;
+
+/*
+ Nearest samples the source pixel the position falls in, like
+ AGKTransformPixelMapper. Bilinear and bicubic (Catmull-Rom) interpolate between
+ pixel centers and give smooth results without rendering at a higher scale
+ first. Bicubic results are clamped so premultiplied color never exceeds alpha.
+ */
+typedef enum AGKPOPWarpFilter {
+    AGKPOPWarpFilterNearest = 0,
+    AGKPOPWarpFilterBilinear,
+    AGKPOPWarpFilterBicubic,
+} AGKPOPWarpFilter;
+
+typedef struct AGKPOPWarpOptions {
+    AGKPOPWarpFilter filter;
+
+    // Where the destination is minified by two or more, sample from a
+    // downscaled copy of the source instead. The level is chosen from the scale
+    // at the middle of every block of 64 pixels.
+    bool mipmaps;
+} AGKPOPWarpOptions;
+
+/**
+ * @discussion
+ *   Pass NULL as options for nearest sampling without mipmaps.
+ */
+void AGKPOPWarp(const AGKPOPWarpBitmap *source, const AGKPOPWarpBitmap *destination, const double matrix[9],
+                const AGKPOPWarpOptions *options);
+
+/**
+ * @discussion
+ *   Warps the rows [firstRow, lastRow) on the calling thread. Useful when the
+ *   caller already schedules work on its own threads. Mipmaps are only built
+ *   by `AGKPOPWarp`, the option is ignored here.
+ */
+void AGKPOPWarpRows(const AGKPOPWarpBitmap *source, const AGKPOPWarpBitmap *destination, const double matrix[9],
+                    const AGKPOPWarpOptions *options, size_t firstRow, size_t lastRow);
+
+/*
+ Warps between buffers owned by the caller without converting or copying them,
+ for instance the planes of a camera CVPixelBuffer. Source and destination must
+ have the same format, otherwise nothing is written and false is returned.
+
+ RGBA8 and BGRA8 are premultiplied with alpha last. YUV420 is three planes Y,
+ Cb and Cr (I420), YUV420BiPlanar is Y and interleaved CbCr (NV12, like
+ kCVPixelFormatType_420YpCbCr8BiPlanarFullRange). Chroma planes are half the
+ width and height of the luma plane, rounded up, and are warped at their own
+ resolution. Chroma coordinates are doubled, mapped with `matrix` and halved,
+ so the chroma planes are warped with
+
+     m[0]       m[1]       m[2] / 2
+     m[3]       m[4]       m[5] / 2
+     m[6] * 2   m[7] * 2   m[8]
+
+ Outside the source luma is cleared to 0 and chroma to 128.
+
+ width and height are those of the first plane. Each plane can have its own
+ bytesPerRow.
+ */
+
+typedef enum AGKPOPWarpPixelFormat {
+    AGKPOPWarpPixelFormatRGBA8 = 0,
+    AGKPOPWarpPixelFormatBGRA8,
+    AGKPOPWarpPixelFormatGray8,
+    AGKPOPWarpPixelFormatYUV420,
+    AGKPOPWarpPixelFormatYUV420BiPlanar,
+} AGKPOPWarpPixelFormat;
+
+typedef struct AGKPOPWarpPlane {
+    uint8_t *data;
+    size_t bytesPerRow;
+} AGKPOPWarpPlane;
+
+typedef struct AGKPOPWarpBuffer {
+    AGKPOPWarpPixelFormat format;
+    size_t width;
+    size_t height;
+    AGKPOPWarpPlane planes[3];
+} AGKPOPWarpBuffer;
+
+bool AGKPOPWarpBuffers(const AGKPOPWarpBuffer *source, const AGKPOPWarpBuffer *destination, const double matrix[9],
+                       const AGKPOPWarpOptions *options);
+
+/*
+ Tiled warp for images that should not be held in memory as a whole. The
+ destination is produced one tile at a time. For every tile only the source
+ pixels its pixels project to (plus a margin for the filter) are read, so the
+ working set is one destination tile and one source tile. When that source tile
+ would exceed maxSourceTileBytes, for instance where the destination is strongly
+ minified or straddles the horizon of the projection, the destination tile is
+ split until its footprint fits.
+
+ `read` fills tile->data with tile->width x tile->height source pixels starting
+ at (x, y) as premultiplied 8-bit RGBA. `write` receives every finished
+ destination tile at (x, y), its data is only valid during the call. Either may
+ return false to abort, and AGKPOPWarpTiled then returns false.
+
+ The result is identical to AGKPOPWarp. Tiles are processed one after another on
+ the calling thread to keep the working set bounded. Mipmaps are not supported
+ and the option is ignored.
+ */
+
+typedef bool (*AGKPOPWarpTileReader)(void *context, const AGKPOPWarpBitmap *tile, size_t x, size_t y);
+typedef bool (*AGKPOPWarpTileWriter)(void *context, const AGKPOPWarpBitmap *tile, size_t x, size_t y);
+
+typedef struct AGKPOPWarpTiling {
+    size_t sourceWidth;
+    size_t sourceHeight;
+    size_t destinationWidth;
+    size_t destinationHeight;
+
+    // Edge length of destination tiles in pixels and the largest source tile,
+    // zero picks 256 pixels and 4 MB
+    size_t tileSize;
+    size_t maxSourceTileBytes;
+
+    AGKPOPWarpTileReader read;
+    AGKPOPWarpTileWriter write;
+    void *context;
+} AGKPOPWarpTiling;
+
+bool AGKPOPWarpTiled(const AGKPOPWarpTiling *tiling, const double matrix[9], const AGKPOPWarpOptions *options);
+
+AGK_EXTERN_C_END
+
+#endif
@@ -0,0 +1,45 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <QuartzCore/QuartzCore.h>
+#import "AGKQuad.h"
+#import "AGKBaseDefines.h"
+
+AGK_EXTERN_C_BEGIN
+
+/**
+ * @discussion
+ *   Array versions of AGKQuadApplyCATransform3D, AGKQuadApplyCGAffineTransform,
+ *   AGKQuadRotateAroundPoint and AGKQuadInterpolate for transforming many quads
+ *   per frame. The transform is unpacked once, every quad is then a handful of
+ *   multiply-adds per corner without going through AGKQuadGet or, for
+ *   CATransform3D, a pair of scratch layers behind a mutex.
+ *
+ *   out may be the same array as the input.
+ */
+void AGKQuadApplyCATransform3DBatch_AGKPOP(const AGKQuad *quads, AGKQuad *out, size_t count, CATransform3D t);
+void AGKQuadApplyCGAffineTransformBatch_AGKPOP(const AGKQuad *quads, AGKQuad *out, size_t count, CGAffineTransform t);
+void AGKQuadRotateAroundPointBatch_AGKPOP(const AGKQuad *quads, AGKQuad *out, size_t count, CGPoint point, CGFloat radians);
+void AGKQuadInterpolateBatch_AGKPOP(const AGKQuad *from, const AGKQuad *to, AGKQuad *out, size_t count, CGFloat progress);
+
+AGK_EXTERN_C_END
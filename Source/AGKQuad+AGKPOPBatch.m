@@ -0,0 +1,98 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "AGKQuad+AGKPOPBatch.h"
+#import "AGKQuad+AGKPOPValues.h"
+
+static inline CGPoint AGKPOPBatchApplyAffine(CGPoint p, CGAffineTransform t)
+{
+    return CGPointMake(t.a * p.x + t.c * p.y + t.tx,
+                       t.b * p.x + t.d * p.y + t.ty);
+}
+
+// Same as CGPointApplyCATransform3D_AGK with a zero anchor point and no parent
+// sublayer transform: the point is in the plane z = 0, so only the x, y and w
+// rows of the transform matter.
+static inline CGPoint AGKPOPBatchApplyPerspective(CGPoint p, CATransform3D t)
+{
+    CGFloat w = t.m14 * p.x + t.m24 * p.y + t.m44;
+    return CGPointMake((t.m11 * p.x + t.m21 * p.y + t.m41) / w,
+                       (t.m12 * p.x + t.m22 * p.y + t.m42) / w);
+}
+
+void AGKQuadApplyCATransform3DBatch_AGKPOP(const AGKQuad *quads, AGKQuad *out, size_t count, CATransform3D t)
+{
+    if(t.m14 == 0 && t.m24 == 0 && t.m44 == 1)
+    {
+        AGKQuadApplyCGAffineTransformBatch_AGKPOP(quads, out, count, CGAffineTransformMake(t.m11, t.m12, t.m21, t.m22, t.m41, t.m42));
+        return;
+    }
+
+    for(size_t i = 0; i < count; i++)
+    {
+        AGKPOPQuadValues q = AGKPOPQuadValuesMake(quads[i]);
+        for(int corner = 0; corner < 4; corner++)
+        {
+            q.v[corner] = AGKPOPBatchApplyPerspective(q.v[corner], t);
+        }
+        out[i] = q.quad;
+    }
+}
+
+void AGKQuadApplyCGAffineTransformBatch_AGKPOP(const AGKQuad *quads, AGKQuad *out, size_t count, CGAffineTransform t)
+{
+    for(size_t i = 0; i < count; i++)
+    {
+        AGKPOPQuadValues q = AGKPOPQuadValuesMake(quads[i]);
+        for(int corner = 0; corner < 4; corner++)
+        {
+            q.v[corner] = AGKPOPBatchApplyAffine(q.v[corner], t);
+        }
+        out[i] = q.quad;
+    }
+}
+
+void AGKQuadRotateAroundPointBatch_AGKPOP(const AGKQuad *quads, AGKQuad *out, size_t count, CGPoint point, CGFloat radians)
+{
+    // Rotation around a point is one affine transform, computed once
+    CGFloat cosa = cos(radians);
+    CGFloat sina = sin(radians);
+    CGAffineTransform t = CGAffineTransformMake(cosa, sina, -sina, cosa,
+                                                point.x - cosa * point.x + sina * point.y,
+                                                point.y - sina * point.x - cosa * point.y);
+    AGKQuadApplyCGAffineTransformBatch_AGKPOP(quads, out, count, t);
+}
+
+void AGKQuadInterpolateBatch_AGKPOP(const AGKQuad *from, const AGKQuad *to, AGKQuad *out, size_t count, CGFloat progress)
+{
+    for(size_t i = 0; i < count; i++)
+    {
+        AGKPOPQuadValues a = AGKPOPQuadValuesMake(from[i]);
+        AGKPOPQuadValues b = AGKPOPQuadValuesMake(to[i]);
+        for(int value = 0; value < 8; value++)
+        {
+            a.values[value] += (b.values[value] - a.values[value]) * progress;
+        }
+        out[i] = a.quad;
+    }
+}
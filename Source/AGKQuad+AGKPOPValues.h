@@ -0,0 +1,123 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <CoreGraphics/CoreGraphics.h>
+#import "AGKQuad.h"
+
+/*
+ Indexed views of an AGKQuad. AGKQuad is four CGPoints in the order tl, tr, br,
+ bl, so it can be read as an array of corners or an array of 8 coordinates
+ without copying. Loops over these arrays have no switch or exception path like
+ AGKQuadGet and AGKQuadModifyCornerAtIndex, so the compiler can unroll and
+ vectorize them.
+
+ Corner indices are the same as for AGKQuadGet and must be 0 to 3.
+ */
+
+typedef union AGKPOPQuadValues {
+    AGKQuad quad;
+    CGPoint v[4];
+    CGFloat values[8];
+} AGKPOPQuadValues;
+
+_Static_assert(sizeof(AGKQuad) == sizeof(CGPoint[4]), "AGKQuad must be four packed points");
+_Static_assert(sizeof(AGKQuad) == sizeof(CGFloat[8]), "AGKQuad must be eight packed coordinates");
+
+static inline AGKPOPQuadValues AGKPOPQuadValuesMake(AGKQuad q)
+{
+    AGKPOPQuadValues values;
+    values.quad = q;
+    return values;
+}
+
+static inline CGPoint AGKPOPQuadGetCorner(AGKQuad q, NSUInteger index)
+{
+    return AGKPOPQuadValuesMake(q).v[index];
+}
+
+static inline AGKQuad AGKPOPQuadSetCorner(AGKQuad q, NSUInteger index, CGPoint point)
+{
+    AGKPOPQuadValues values = AGKPOPQuadValuesMake(q);
+    values.v[index] = point;
+    return values.quad;
+}
+
+static inline void AGKPOPQuadGetXValues(AGKQuad q, CGFloat *out)
+{
+    AGKPOPQuadValues values = AGKPOPQuadValuesMake(q);
+    for(int i = 0; i < 4; i++)
+    {
+        out[i] = values.v[i].x;
+    }
+}
+
+static inline void AGKPOPQuadGetYValues(AGKQuad q, CGFloat *out)
+{
+    AGKPOPQuadValues values = AGKPOPQuadValuesMake(q);
+    for(int i = 0; i < 4; i++)
+    {
+        out[i] = values.v[i].y;
+    }
+}
+
+static inline void AGKPOPQuadGetDoubles(AGKQuad q, double *out)
+{
+    AGKPOPQuadValues values = AGKPOPQuadValuesMake(q);
+    for(int i = 0; i < 8; i++)
+    {
+        out[i] = values.values[i];
+    }
+}
+
+static inline AGKQuad AGKPOPQuadMakeWithDoubles(const double *in)
+{
+    AGKPOPQuadValues values;
+    for(int i = 0; i < 8; i++)
+    {
+        values.values[i] = in[i];
+    }
+    return values.quad;
+}
+
+static inline BOOL AGKPOPQuadEqual(AGKQuad q1, AGKQuad q2)
+{
+    AGKPOPQuadValues a = AGKPOPQuadValuesMake(q1);
+    AGKPOPQuadValues b = AGKPOPQuadValuesMake(q2);
+    BOOL equal = YES;
+    for(int i = 0; i < 8; i++)
+    {
+        equal &= a.values[i] == b.values[i];
+    }
+    return equal;
+}
+
+static inline BOOL AGKPOPQuadContainsValidValues(AGKQuad q)
+{
+    AGKPOPQuadValues values = AGKPOPQuadValuesMake(q);
+    BOOL valid = YES;
+    for(int i = 0; i < 8; i++)
+    {
+        valid &= isfinite(values.values[i]) ? YES : NO;
+    }
+    return valid;
+}
@@ -0,0 +1,86 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <QuartzCore/QuartzCore.h>
+#import "AGKQuad.h"
+
+/**
+ * @discussion
+ *   The transforms of a keyframe animation between two quadrilaterals, stored
+ *   in one contiguous buffer. Frames are solved in parallel and tables are
+ *   cached, so animating between the same quadrilaterals again (a card flipped
+ *   back and forth) reuses the table instead of solving every frame anew.
+ *
+ *   Tables are keyed by the quadrilaterals relative to the layer position, the
+ *   layer size, the number of frames and the progress the ease function returns
+ *   for each frame, so different blocks describing the same curve share a table.
+ *   The ease function is called on the calling thread only, once per frame on
+ *   every call.
+ */
+@interface AGKPOPKeyframeTable : NSObject
+
++ (instancetype)tableBetweenQuadrilateral:(AGKQuad)quad1
+                         andQuadrilateral:(AGKQuad)quad2
+                                layerSize:(CGSize)layerSize
+                            layerPosition:(CGPoint)layerPosition
+                        forNumberOfFrames:(NSUInteger)numberOfFrames
+                             easeFunction:(double(^)(double p))progressFunction;
+
++ (void)removeAllCachedTables;
+
+@property (nonatomic, assign, readonly) NSUInteger count;
+@property (nonatomic, assign, readonly) const CATransform3D *transforms;
+
+// Boxed once per table for CAKeyframeAnimation, which only takes NSValue's
+@property (nonatomic, strong, readonly) NSArray *values;
+
+@end
+
+/**
+ * @discussion
+ *   Same as the animation methods in CALayer+AGKQuad, but the keyframes come
+ *   from a cached AGKPOPKeyframeTable.
+ */
+@interface CALayer (AGKPOPKeyframes)
+
++ (CAKeyframeAnimation *)AGKAnimationBetweenQuadrilateral:(AGKQuad)quad1
+                                         andQuadrilateral:(AGKQuad)quad2
+                                                layerSize:(CGSize)layerSize
+                                            layerPosition:(CGPoint)layerPosition
+                                        forNumberOfFrames:(NSUInteger)numberOfFrames
+                                                    delay:(NSTimeInterval)delay
+                                                 duration:(NSTimeInterval)duration
+                                             easeFunction:(double(^)(double p))progressFunction
+                                                  onStart:(void(^)(void))onStart
+                                               onComplete:(void(^)(BOOL finished))onComplete;
+
+- (void)AGKAnimateFromQuadrilateral:(AGKQuad)quad1
+                    toQuadrilateral:(AGKQuad)quad2
+                  forNumberOfFrames:(NSUInteger)numberOfFrames
+                           duration:(NSTimeInterval)duration
+                              delay:(NSTimeInterval)delay
+                            animKey:(NSString *)animKey
+                       easeFunction:(double(^)(double p))progressFunction
+                         onComplete:(void(^)(BOOL finished))onComplete;
+
+@end
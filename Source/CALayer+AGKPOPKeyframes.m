@@ -0,0 +1,311 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "CALayer+AGKPOPKeyframes.h"
+#import "CALayer+AGKQuad.h"
+#import "AGKCALayerAnimationBlockDelegate.h"
+#import "AGKPOPParallel.h"
+#import "AGKQuad+AGKPOPValues.h"
+
+// Solving a frame is cheap, so frames are handed out to threads in chunks
+static size_t const kAGKPOPKeyframeTableChunk = 64;
+
+// About 128 tables of 60 frames, the cost of a table being the size of its transforms and progress
+static NSUInteger const kAGKPOPKeyframeTableCacheCostLimit = 1024 * 1024;
+
+typedef struct AGKPOPKeyframeTableJob {
+    const double *progress;
+    AGKQuad from;
+    AGKQuad to;
+    CGRect bounds;
+    CATransform3D *transforms;
+    size_t count;
+} AGKPOPKeyframeTableJob;
+
+static void AGKPOPKeyframeTableSolveChunk(void *context, size_t chunk)
+{
+    AGKPOPKeyframeTableJob *job = context;
+    size_t first = chunk * kAGKPOPKeyframeTableChunk;
+    size_t last = MIN(first + kAGKPOPKeyframeTableChunk, job->count);
+    for(size_t i = first; i < last; i++)
+    {
+        AGKQuad quad = AGKQuadInterpolate(job->from, job->to, job->progress[i]);
+        job->transforms[i] = CATransform3DWithAGKQuadFromBounds(quad, job->bounds);
+    }
+}
+
+static NSUInteger AGKPOPKeyframeTableHashValue(NSUInteger hash, CGFloat value)
+{
+    double normalized = (double)value + 0.0; // -0 and 0 compare equal, so they must hash equal
+    uint64_t bits;
+    memcpy(&bits, &normalized, sizeof(bits));
+    return hash * 31 + (NSUInteger)(bits ^ (bits >> 32));
+}
+
+@interface AGKPOPKeyframeTableKey : NSObject <NSCopying>
+{
+@public
+    AGKQuad _from;
+    AGKQuad _to;
+    CGSize _size;
+    NSUInteger _count;
+    double *_progress; // the ease function sampled at each frame, so equal curves share a table
+}
+@end
+
+@implementation AGKPOPKeyframeTableKey
+
+- (void)dealloc
+{
+    free(_progress);
+}
+
+- (id)copyWithZone:(NSZone *)zone
+{
+    return self;
+}
+
+- (NSUInteger)hash
+{
+    AGKPOPQuadValues from = AGKPOPQuadValuesMake(_from);
+    AGKPOPQuadValues to = AGKPOPQuadValuesMake(_to);
+    NSUInteger hash = _count;
+    for(int i = 0; i < 8; i++)
+    {
+        hash = AGKPOPKeyframeTableHashValue(hash, from.values[i]);
+        hash = AGKPOPKeyframeTableHashValue(hash, to.values[i]);
+    }
+    for(NSUInteger i = 0; i < _count; i++)
+    {
+        hash = AGKPOPKeyframeTableHashValue(hash, _progress[i]);
+    }
+    hash = AGKPOPKeyframeTableHashValue(hash, _size.width);
+    hash = AGKPOPKeyframeTableHashValue(hash, _size.height);
+    return hash;
+}
+
+- (BOOL)isEqual:(id)object
+{
+    if(![object isKindOfClass:[AGKPOPKeyframeTableKey class]])
+    {
+        return NO;
+    }
+    AGKPOPKeyframeTableKey *other = object;
+    if(_count != other->_count ||
+       !CGSizeEqualToSize(_size, other->_size) ||
+       !AGKPOPQuadEqual(_from, other->_from) ||
+       !AGKPOPQuadEqual(_to, other->_to))
+    {
+        return NO;
+    }
+    for(NSUInteger i = 0; i < _count; i++)
+    {
+        if(_progress[i] != other->_progress[i])
+        {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+@end
+
+@implementation AGKPOPKeyframeTable
+{
+    CATransform3D *_transforms;
+    NSArray *_values;
+}
+
++ (NSCache *)cache
+{
+    static NSCache *cache = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        cache = [[NSCache alloc] init];
+        cache.name = @"AGKPOPKeyframeTable";
+        cache.totalCostLimit = kAGKPOPKeyframeTableCacheCostLimit;
+    });
+    return cache;
+}
+
++ (instancetype)tableBetweenQuadrilateral:(AGKQuad)quad1
+                         andQuadrilateral:(AGKQuad)quad2
+                                layerSize:(CGSize)layerSize
+                            layerPosition:(CGPoint)layerPosition
+                        forNumberOfFrames:(NSUInteger)numberOfFrames
+                             easeFunction:(double(^)(double p))progressFunction
+{
+    AGKPOPKeyframeTableKey *key = [[AGKPOPKeyframeTableKey alloc] init];
+    key->_from = AGKQuadMove(quad1, -layerPosition.x, -layerPosition.y);
+    key->_to = AGKQuadMove(quad2, -layerPosition.x, -layerPosition.y);
+    key->_size = layerSize;
+    key->_count = numberOfFrames;
+
+    // The ease function may not be thread safe, so it is sampled here and only the solving is done in parallel
+    key->_progress = malloc(MAX(numberOfFrames, 1) * sizeof(double));
+    for(NSUInteger i = 0; i < numberOfFrames; i++)
+    {
+        key->_progress[i] = progressFunction((double)i / (double)numberOfFrames);
+    }
+
+    NSCache *cache = [self cache];
+    AGKPOPKeyframeTable *table = [cache objectForKey:key];
+    if(!table)
+    {
+        table = [[self alloc] initWithKey:key];
+        [cache setObject:table forKey:key cost:numberOfFrames * (sizeof(CATransform3D) + sizeof(double))];
+    }
+    return table;
+}
+
++ (void)removeAllCachedTables
+{
+    [[self cache] removeAllObjects];
+}
+
+- (instancetype)initWithKey:(AGKPOPKeyframeTableKey *)key
+{
+    self = [super init];
+    if(self)
+    {
+        _count = key->_count;
+        _transforms = malloc(MAX(_count, 1) * sizeof(CATransform3D));
+
+        AGKPOPKeyframeTableJob job;
+        job.progress = key->_progress;
+        job.from = key->_from;
+        job.to = key->_to;
+        job.bounds = (CGRect){CGPointZero, key->_size};
+        job.transforms = _transforms;
+        job.count = _count;
+        AGKPOPParallelApply((_count + kAGKPOPKeyframeTableChunk - 1) / kAGKPOPKeyframeTableChunk, &job, AGKPOPKeyframeTableSolveChunk);
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    free(_transforms);
+}
+
+- (const CATransform3D *)transforms
+{
+    return _transforms;
+}
+
+- (NSArray *)values
+{
+    @synchronized(self)
+    {
+        if(!_values)
+        {
+            NSMutableArray *values = [NSMutableArray arrayWithCapacity:_count];
+            for(NSUInteger i = 0; i < _count; i++)
+            {
+                [values addObject:[NSValue valueWithCATransform3D:_transforms[i]]];
+            }
+            _values = [values copy];
+        }
+        return _values;
+    }
+}
+
+@end
+
+@implementation CALayer (AGKPOPKeyframes)
+
++ (CAKeyframeAnimation *)AGKAnimationBetweenQuadrilateral:(AGKQuad)quad1
+                                         andQuadrilateral:(AGKQuad)quad2
+                                                layerSize:(CGSize)layerSize
+                                            layerPosition:(CGPoint)layerPosition
+                                        forNumberOfFrames:(NSUInteger)numberOfFrames
+                                                    delay:(NSTimeInterval)delay
+                                                 duration:(NSTimeInterval)duration
+                                             easeFunction:(double(^)(double p))progressFunction
+                                                  onStart:(void(^)(void))onStart
+                                               onComplete:(void(^)(BOOL finished))onComplete
+{
+    CAKeyframeAnimation *animation = [CAKeyframeAnimation animationWithKeyPath:@"transform"];
+    animation.duration = duration;
+    animation.repeatCount = 1;
+    animation.removedOnCompletion = NO;
+    animation.fillMode = kCAFillModeForwards;
+    animation.beginTime = CACurrentMediaTime() + delay;
+
+    AGKPOPKeyframeTable *table = [AGKPOPKeyframeTable tableBetweenQuadrilateral:quad1
+                                                               andQuadrilateral:quad2
+                                                                      layerSize:layerSize
+                                                                  layerPosition:layerPosition
+                                                              forNumberOfFrames:numberOfFrames
+                                                                   easeFunction:progressFunction];
+    animation.values = table.values;
+    animation.delegate = [AGKCALayerAnimationBlockDelegate newWithAnimationDidStart:onStart didStop:onComplete];
+
+    return animation;
+}
+
+- (void)AGKAnimateFromQuadrilateral:(AGKQuad)quad1
+                    toQuadrilateral:(AGKQuad)quad2
+                  forNumberOfFrames:(NSUInteger)numberOfFrames
+                           duration:(NSTimeInterval)duration
+                              delay:(NSTimeInterval)delay
+                            animKey:(NSString *)animKey
+                       easeFunction:(double(^)(double p))progressFunction
+                         onComplete:(void(^)(BOOL finished))onComplete
+{
+    if(!CGPointEqualToPoint(self.anchorPoint, CGPointZero))
+    {
+        [NSException raise:NSInternalInconsistencyException format:@"Before using any quadrilaterals the layers anchorPoint property must be {0, 0}. You may use the category method -[CALayer ensureAnchorPointIsSetToZero]"];
+    }
+
+    [CATransaction begin];
+
+    __weak __typeof__(self) wself = self;
+
+    CAKeyframeAnimation *anim = [[self class] AGKAnimationBetweenQuadrilateral:quad1
+                                                              andQuadrilateral:quad2
+                                                                     layerSize:self.bounds.size
+                                                                 layerPosition:self.position
+                                                             forNumberOfFrames:numberOfFrames
+                                                                         delay:delay
+                                                                      duration:duration
+                                                                  easeFunction:progressFunction
+                                                                       onStart:^{
+                                                                           wself.quadrilateral = quad2;
+                                                                       } onComplete:^(BOOL finished) {
+                                                                           if(finished)
+                                                                           {
+                                                                               [wself removeAnimationForKey:animKey];
+                                                                           }
+                                                                           if(onComplete)
+                                                                           {
+                                                                               onComplete(finished);
+                                                                           }
+                                                                       }];
+
+    [self addAnimation:anim forKey:animKey];
+
+    [CATransaction commit];
+}
+
+@end
@@ -0,0 +1,66 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <QuartzCore/QuartzCore.h>
+#import <POP/POP.h>
+#import "AGKQuad.h"
+#import "AGKBaseDefines.h"
+#import "AGKPOPDecay.h"
+
+extern NSString * const kAGKPOPQuadDecayAnimationKey;
+
+AGK_EXTERN_C_BEGIN
+
+/**
+ * @discussion
+ *   Where a decay of the quadrilateral with the given velocity (points per
+ *   second for each coordinate) comes to rest, using the same deceleration and
+ *   stop condition as POPDecayAnimation on the corner properties. The time it
+ *   takes is returned in duration if it is not NULL. A deceleration of 1 or
+ *   more never comes to rest, see AGKPOPDecayProjectedValue.
+ */
+AGKQuad AGKQuadProjectedDecay_AGKPOP(AGKQuad from, AGKQuad velocity, CGFloat deceleration, CFTimeInterval *duration);
+
+AGK_EXTERN_C_END
+
+/**
+ * @discussion
+ *   Decays the whole quadrilateral like POPDecayAnimation, but evaluated in
+ *   closed form from the start values at every frame (see AGKPOPDecay.h). The
+ *   resting quadrilateral and the duration are known up front, so a snap can be
+ *   scheduled or the destination rendered before the animation has run.
+ *
+ *   A decay that never stops (deceleration of 1 or more) runs until it is
+ *   removed.
+ *
+ *   Starting a decay removes a running quadrilateral spring and the other way
+ *   around. Pass kAGKPOPDecayDefaultDeceleration for POP's default.
+ */
+@interface CALayer (AGKPOPQuadDecay)
+
+- (POPCustomAnimation *)AGKDecayQuadrilateralWithVelocity:(AGKQuad)velocity
+                                              deceleration:(CGFloat)deceleration;
+
+- (void)AGKRemoveQuadrilateralDecay;
+
+@end
@@ -0,0 +1,95 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "CALayer+AGKPOPQuadDecay.h"
+#import "CALayer+AGKPOPQuadSpring.h"
+#import "AGKPOPQuadCoalescer.h"
+#import "AGKPOPDecay.h"
+#import "AGKQuad+AGKPOPValues.h"
+
+NSString * const kAGKPOPQuadDecayAnimationKey = @"AGKPOPQuadDecay";
+
+// Same as kPOPLayerAGKQuadThreshold of the corner properties
+static CGFloat const kAGKPOPQuadDecayThreshold = 1.0;
+
+// Captured by value by the animation block
+typedef struct AGKPOPQuadDecayState {
+    double from[8];
+    double velocity[8];
+    double deceleration;
+    double duration;
+} AGKPOPQuadDecayState;
+
+AGKQuad AGKQuadProjectedDecay_AGKPOP(AGKQuad from, AGKQuad velocity, CGFloat deceleration, CFTimeInterval *duration)
+{
+    double p[8];
+    double v[8];
+    AGKPOPQuadGetDoubles(from, p);
+    AGKPOPQuadGetDoubles(velocity, v);
+
+    double t = AGKPOPDecayProjectedValue(p, v, 8, deceleration, kAGKPOPQuadDecayThreshold, p);
+    if(duration)
+    {
+        *duration = t;
+    }
+    return AGKPOPQuadMakeWithDoubles(p);
+}
+
+@implementation CALayer (AGKPOPQuadDecay)
+
+- (POPCustomAnimation *)AGKDecayQuadrilateralWithVelocity:(AGKQuad)velocity
+                                              deceleration:(CGFloat)deceleration
+{
+    [self AGKRemoveQuadrilateralSpring];
+    [self pop_removeAnimationForKey:kAGKPOPQuadDecayAnimationKey];
+
+    AGKPOPQuadDecayState decay;
+    AGKPOPQuadGetDoubles(AGKPOPQuadCoalescerRead(self), decay.from);
+    AGKPOPQuadGetDoubles(velocity, decay.velocity);
+    decay.deceleration = deceleration;
+    decay.duration = AGKPOPDecayDuration(decay.velocity, 8, deceleration, kAGKPOPQuadDecayThreshold);
+
+    __block CFTimeInterval beginTime = -1;
+    POPCustomAnimation *anim = [POPCustomAnimation animationWithBlock:^BOOL(id target, POPCustomAnimation *animation) {
+        if(beginTime < 0)
+        {
+            beginTime = animation.currentTime;
+        }
+
+        double t = MIN(animation.currentTime - beginTime, decay.duration);
+        double values[8];
+        AGKPOPDecayEvaluate(decay.from, decay.velocity, 8, decay.deceleration, t, values, NULL);
+        AGKPOPQuadCoalescerWrite(target, AGKPOPQuadMakeWithDoubles(values));
+        return t < decay.duration;
+    }];
+    [self pop_addAnimation:anim forKey:kAGKPOPQuadDecayAnimationKey];
+
+    return anim;
+}
+
+- (void)AGKRemoveQuadrilateralDecay
+{
+    [self pop_removeAnimationForKey:kAGKPOPQuadDecayAnimationKey];
+}
+
+@end
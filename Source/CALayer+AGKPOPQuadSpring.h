@@ -0,0 +1,55 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <QuartzCore/QuartzCore.h>
+#import <POP/POP.h>
+#import "AGKQuad.h"
+
+extern NSString * const kAGKPOPQuadSpringAnimationKey;
+
+/**
+ * @discussion
+ *   Animates the whole quadrilateral with one spring per coordinate. Unlike the
+ *   corner properties, which are driven by POPSpringAnimation and integrated with
+ *   RK4 in steps of 1 ms, the spring is solved in closed form (see AGKPOPSpring.h).
+ *   Every frame costs the same regardless of its duration and all corners are
+ *   written to the layer at once.
+ *
+ *   Calling any of these methods while the spring is running retargets it and
+ *   keeps the current velocity. The returned animation is the one added to the
+ *   layer for `kAGKPOPQuadSpringAnimationKey`, use it to set a completionBlock.
+ */
+@interface CALayer (AGKPOPQuadSpring)
+
+- (POPCustomAnimation *)AGKSpringToQuadrilateral:(AGKQuad)quad
+                                       bounciness:(CGFloat)bounciness
+                                            speed:(CGFloat)speed;
+
+- (POPCustomAnimation *)AGKSpringToQuadrilateral:(AGKQuad)quad
+                                          tension:(CGFloat)tension
+                                         friction:(CGFloat)friction
+                                             mass:(CGFloat)mass;
+
+- (void)AGKRemoveQuadrilateralSpring;
+
+@end
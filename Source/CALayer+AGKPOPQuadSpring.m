@@ -0,0 +1,200 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "CALayer+AGKPOPQuadSpring.h"
+#import "CALayer+AGKPOPQuadDecay.h"
+#import "AGKPOPQuadCoalescer.h"
+#import "AGKPOPQuadSpringSystem.h"
+#import "AGKQuad+AGKPOPValues.h"
+#import <objc/runtime.h>
+
+NSString * const kAGKPOPQuadSpringAnimationKey = @"AGKPOPQuadSpring";
+
+static CGFloat const kAGKPOPQuadSpringThreshold = 1.0;
+
+// All quad springs share one system which is advanced once per animator frame,
+// by whichever spring animation is called first in that frame.
+static AGKPOPQuadSpringSystem *AGKPOPQuadSpringSharedSystem(void)
+{
+    static AGKPOPQuadSpringSystem *system;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        system = AGKPOPQuadSpringSystemCreate();
+    });
+    return system;
+}
+
+@interface AGKPOPQuadSpringState : NSObject
+{
+@public
+    AGKPOPSpringBatchHandle spring; // handle in the shared system
+}
+@end
+
+@implementation AGKPOPQuadSpringState
+
+- (instancetype)init
+{
+    self = [super init];
+    if(self)
+    {
+        spring = kAGKPOPSpringBatchInvalidHandle;
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [self removeFromBatch];
+}
+
+- (void)removeFromBatch
+{
+    if(spring != kAGKPOPSpringBatchInvalidHandle)
+    {
+        AGKPOPQuadSpringSystem *system = AGKPOPQuadSpringSharedSystem();
+        AGKPOPQuadSpringSystemRemove(system, spring);
+        spring = kAGKPOPSpringBatchInvalidHandle;
+
+        // Animation time of the next spring may start anywhere
+        if(AGKPOPQuadSpringSystemCount(system) == 0)
+        {
+            AGKPOPQuadSpringSystemStopClock(system);
+        }
+    }
+}
+
+- (BOOL)advanceLayer:(CALayer *)layer currentTime:(CFTimeInterval)time
+{
+    if(spring == kAGKPOPSpringBatchInvalidHandle)
+    {
+        return NO;
+    }
+
+    AGKPOPQuadSpringSystem *system = AGKPOPQuadSpringSharedSystem();
+    AGKPOPQuadSpringSystemAdvanceToTime(system, time);
+
+    double values[8];
+    BOOL converged = AGKPOPQuadSpringSystemHasConverged(system, spring, kAGKPOPQuadSpringThreshold);
+    if(converged)
+    {
+        AGKPOPQuadSpringSystemGetTarget(system, spring, values);
+    }
+    else
+    {
+        AGKPOPQuadSpringSystemGetValues(system, spring, values);
+    }
+    AGKPOPQuadCoalescerWrite(layer, AGKPOPQuadMakeWithDoubles(values));
+
+    if(converged)
+    {
+        [self removeFromBatch];
+    }
+
+    return !converged;
+}
+
+@end
+
+static char kAGKPOPQuadSpringStateKey;
+
+@implementation CALayer (AGKPOPQuadSpring)
+
+- (POPCustomAnimation *)AGKSpringToQuadrilateral:(AGKQuad)quad
+                                       bounciness:(CGFloat)bounciness
+                                            speed:(CGFloat)speed
+{
+    CGFloat tension, friction, mass;
+    [POPSpringAnimation convertBounciness:bounciness speed:speed toTension:&tension friction:&friction mass:&mass];
+    return [self AGKSpringToQuadrilateral:quad tension:tension friction:friction mass:mass];
+}
+
+- (POPCustomAnimation *)AGKSpringToQuadrilateral:(AGKQuad)quad
+                                          tension:(CGFloat)tension
+                                         friction:(CGFloat)friction
+                                             mass:(CGFloat)mass
+{
+    POPCustomAnimation *anim = [self pop_animationForKey:kAGKPOPQuadSpringAnimationKey];
+    AGKPOPQuadSpringState *state = objc_getAssociatedObject(self, &kAGKPOPQuadSpringStateKey);
+    AGKPOPQuadSpringSystem *system = AGKPOPQuadSpringSharedSystem();
+    if(system == NULL)
+    {
+        // Out of memory, jump to the target like when the spring can't be added
+        [self pop_removeAnimationForKey:kAGKPOPQuadSpringAnimationKey];
+        AGKPOPQuadCoalescerWrite(self, quad);
+        return nil;
+    }
+
+    double targetValues[8];
+    AGKPOPQuadGetDoubles(quad, targetValues);
+
+    if(anim != nil && state != nil && state->spring != kAGKPOPSpringBatchInvalidHandle)
+    {
+        // Retarget a running spring and keep its velocity
+        AGKPOPQuadSpringSystemRetarget(system, state->spring, targetValues, tension, friction, mass);
+    }
+    else
+    {
+        if(state == nil)
+        {
+            state = [AGKPOPQuadSpringState new];
+            objc_setAssociatedObject(self, &kAGKPOPQuadSpringStateKey, state, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+        }
+        [state removeFromBatch];
+        [self AGKRemoveQuadrilateralDecay];
+
+        double current[8];
+        AGKPOPQuadGetDoubles(AGKPOPQuadCoalescerRead(self), current);
+
+        state->spring = AGKPOPQuadSpringSystemAdd(system, current, targetValues, tension, friction, mass);
+        if(state->spring == kAGKPOPSpringBatchInvalidHandle)
+        {
+            [self pop_removeAnimationForKey:kAGKPOPQuadSpringAnimationKey];
+            AGKPOPQuadCoalescerWrite(self, quad);
+            return nil;
+        }
+    }
+
+    if(anim == nil)
+    {
+        anim = [POPCustomAnimation animationWithBlock:^BOOL(id target, POPCustomAnimation *animation) {
+            CALayer *layer = target;
+            AGKPOPQuadSpringState *layerState = objc_getAssociatedObject(layer, &kAGKPOPQuadSpringStateKey);
+            return [layerState advanceLayer:layer currentTime:animation.currentTime];
+        }];
+        [self pop_addAnimation:anim forKey:kAGKPOPQuadSpringAnimationKey];
+    }
+
+    return anim;
+}
+
+- (void)AGKRemoveQuadrilateralSpring
+{
+    [self pop_removeAnimationForKey:kAGKPOPQuadSpringAnimationKey];
+
+    AGKPOPQuadSpringState *state = objc_getAssociatedObject(self, &kAGKPOPQuadSpringStateKey);
+    [state removeFromBatch];
+    objc_setAssociatedObject(self, &kAGKPOPQuadSpringStateKey, nil, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+}
+
+@end
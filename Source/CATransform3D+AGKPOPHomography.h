@@ -0,0 +1,54 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <Foundation/Foundation.h>
+#import <QuartzCore/QuartzCore.h>
+#import "AGKQuad.h"
+#import "AGKBaseDefines.h"
+
+AGK_EXTERN_C_BEGIN
+
+/**
+ * @discussion
+ *   The transform that maps each corner of source onto the matching corner of
+ *   destination, solved in closed form with the functions in
+ *   AGKPOPHomography.h. Replaces the Jacobi SVD on boxed matrices used by
+ *   `generatePerspectiveTransformMatrixFromQuad:toQuad:` in UIImage+AGKQuad.m.
+ *   Does not allocate. Returns CATransform3DIdentity when a quad is degenerate.
+ */
+CATransform3D CATransform3DWithAGKQuadFromQuad_AGKPOP(AGKQuad source, AGKQuad destination);
+
+/**
+ * @discussion
+ *   Same result as `CATransform3DWithAGKQuadFromRect`. Returns
+ *   CATransform3DIdentity when the rect is empty or the quad is degenerate.
+ */
+CATransform3D CATransform3DWithAGKQuadFromRect_AGKPOP(AGKQuad quad, CGRect rect);
+
+/**
+ * @discussion
+ *   The transform of a homography in the form used by AGKPOPHomography.h.
+ */
+CATransform3D CATransform3DWithHomography_AGKPOP(const double h[9]);
+
+AGK_EXTERN_C_END
@@ -0,0 +1,67 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "CATransform3D+AGKPOPHomography.h"
+#import "AGKPOPHomography.h"
+#import "AGKQuad+AGKPOPValues.h"
+
+CATransform3D CATransform3DWithHomography_AGKPOP(const double h[9])
+{
+    CATransform3D transform = CATransform3DIdentity;
+    transform.m11 = h[0];
+    transform.m21 = h[1];
+    transform.m41 = h[2];
+    transform.m12 = h[3];
+    transform.m22 = h[4];
+    transform.m42 = h[5];
+    transform.m14 = h[6];
+    transform.m24 = h[7];
+    transform.m44 = h[8];
+    return transform;
+}
+
+CATransform3D CATransform3DWithAGKQuadFromQuad_AGKPOP(AGKQuad source, AGKQuad destination)
+{
+    double from[8];
+    double to[8];
+    double h[9];
+    AGKPOPQuadGetDoubles(source, from);
+    AGKPOPQuadGetDoubles(destination, to);
+    if(!AGKPOPHomographyQuadToQuad(from, to, h))
+    {
+        return CATransform3DIdentity;
+    }
+    return CATransform3DWithHomography_AGKPOP(h);
+}
+
+CATransform3D CATransform3DWithAGKQuadFromRect_AGKPOP(AGKQuad quad, CGRect rect)
+{
+    double to[8];
+    double h[9];
+    AGKPOPQuadGetDoubles(quad, to);
+    if(!AGKPOPHomographyRectToQuad(rect.origin.x, rect.origin.y, rect.size.width, rect.size.height, to, h))
+    {
+        return CATransform3DIdentity;
+    }
+    return CATransform3DWithHomography_AGKPOP(h);
+}
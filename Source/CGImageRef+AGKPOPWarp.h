@@ -0,0 +1,76 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <Foundation/Foundation.h>
+#import <CoreGraphics/CoreGraphics.h>
+#import <QuartzCore/QuartzCore.h>
+#import "AGKBaseDefines.h"
+#import "AGKPOPWarp.h"
+
+AGK_EXTERN_C_BEGIN
+
+/**
+ * @discussion
+ *   Same result as `CGImageDrawWithCATransform3D_AGK` from AGGeometryKit, but
+ *   warped with the multithreaded kernel in AGKPOPWarp.h instead of sending
+ *   one Objective-C message per pixel.
+ */
+CGImageRef CGImageDrawWithCATransform3D_AGKPOP(CGImageRef imageRef,
+                                               CATransform3D transform,
+                                               CGPoint anchorPoint,
+                                               CGSize size,
+                                               CGFloat scale) CF_RETURNS_RETAINED;
+
+/**
+ * @discussion
+ *   Same as above with a choice of filter and mipmaps. Bilinear or bicubic
+ *   filtering renders acceptable results directly at the target scale, so
+ *   there is no need to render at a larger scale and downsample afterwards.
+ *   Pass NULL as options for nearest sampling.
+ */
+CGImageRef CGImageDrawWithCATransform3DOptions_AGKPOP(CGImageRef imageRef,
+                                                      CATransform3D transform,
+                                                      CGPoint anchorPoint,
+                                                      CGSize size,
+                                                      CGFloat scale,
+                                                      const AGKPOPWarpOptions *options) CF_RETURNS_RETAINED;
+
+/**
+ * @discussion
+ *   Same as above, but the source is never decoded as a whole. It is drawn a
+ *   tile at a time into a small buffer as the destination tiles need it (see
+ *   AGKPOPWarpTiled), so peak memory is the result plus a few tiles instead
+ *   of two full size bitmaps. Slower than the other variants since tiles are
+ *   warped one after another. Meant for large photos where memory runs out.
+ *   CoreGraphics may still cache a decoded copy of images backed by
+ *   compressed data, use AGKPOPWarpTiled with a tiled decoder to bound memory
+ *   completely.
+ */
+CGImageRef CGImageDrawWithCATransform3DTiled_AGKPOP(CGImageRef imageRef,
+                                                    CATransform3D transform,
+                                                    CGPoint anchorPoint,
+                                                    CGSize size,
+                                                    CGFloat scale,
+                                                    const AGKPOPWarpOptions *options) CF_RETURNS_RETAINED;
+
+AGK_EXTERN_C_END
@@ -0,0 +1,229 @@
+//
+// Author: Håvard Fossli <hfossli@agens.no>
+//
+// Copyright (c) 2013 Agens AS (http://agens.no/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "CGImageRef+AGKPOPWarp.h"
+#import "AGKPOPWarp.h"
+#import "AGKPOPMatrix.h"
+#import "AGKPOPBufferPool.h"
+
+// Homography from destination pixel to source pixel. Pixels are first moved to
+// model space centered on the image (like AGKTransformPixelMapper does), then
+// mapped back through the inverse of the 2D part of the transform.
+static BOOL AGKPOPWarpMatrixForTransform(CATransform3D t, size_t width, size_t height, double scale, double out[9])
+{
+    double forward[9] = {
+        t.m11, t.m21, t.m41,
+        t.m12, t.m22, t.m42,
+        t.m14, t.m24, t.m44,
+    };
+    double inverse[9];
+    if(!AGKPOPMatrix3x3Invert(forward, inverse))
+    {
+        return NO;
+    }
+
+    double toModel[9] = {
+        1.0 / scale, 0, -(double)width / (2.0 * scale),
+        0, 1.0 / scale, -(double)height / (2.0 * scale),
+        0, 0, 1,
+    };
+    double toPixels[9] = {
+        scale, 0, 0,
+        0, scale, 0,
+        0, 0, 1,
+    };
+
+    AGKPOPMatrix3x3Multiply(inverse, toModel, out);
+    AGKPOPMatrix3x3Multiply(toPixels, out, out);
+    return YES;
+}
+
+CGImageRef CGImageDrawWithCATransform3D_AGKPOP(CGImageRef imageRef,
+                                               CATransform3D transform,
+                                               CGPoint anchorPoint,
+                                               CGSize size,
+                                               CGFloat scale)
+{
+    return CGImageDrawWithCATransform3DOptions_AGKPOP(imageRef, transform, anchorPoint, size, scale, NULL);
+}
+
+// Moves the anchor point like CGImageDrawWithCATransform3D_AGK before building
+// the homography from destination pixel to source pixel
+static BOOL AGKPOPWarpMatrixForImage(CATransform3D transform, CGPoint anchorPoint, CGSize size,
+                                     size_t width, size_t height, CGFloat scale, double out[9])
+{
+    CATransform3D translateDueToAnchor = CATransform3DMakeTranslation(size.width * (-anchorPoint.x),
+                                                                      size.height * (-anchorPoint.y),
+                                                                      0);
+
+    CATransform3D translateDueToDisposition = CATransform3DMakeTranslation(size.width * (-0.5 + anchorPoint.x),
+                                                                           size.height * (-0.5 + anchorPoint.y),
+                                                                           0);
+
+    transform = CATransform3DConcat(translateDueToAnchor, transform);
+    transform = CATransform3DConcat(transform, translateDueToDisposition);
+
+    return AGKPOPWarpMatrixForTransform(transform, width, height, scale, out);
+}
+
+static CGBitmapInfo const kAGKPOPWarpBitmapInfo = (CGBitmapInfo)kCGImageAlphaPremultipliedLast | kCGBitmapByteOrder32Big;
+
+static CGImageRef AGKPOPWarpCreateImage(uint8_t *data, size_t width, size_t height, size_t bytesPerRow, CGColorSpaceRef colorSpace)
+{
+    CGContextRef ctx = CGBitmapContextCreate(data, width, height, 8, bytesPerRow, colorSpace, kAGKPOPWarpBitmapInfo);
+    CGImageRef newImageRef = CGBitmapContextCreateImage(ctx);
+    CGContextRelease(ctx);
+    return newImageRef;
+}
+
+CGImageRef CGImageDrawWithCATransform3DOptions_AGKPOP(CGImageRef imageRef,
+                                                      CATransform3D transform,
+                                                      CGPoint anchorPoint,
+                                                      CGSize size,
+                                                      CGFloat scale,
+                                                      const AGKPOPWarpOptions *options)
+{
+    size_t width = CGImageGetWidth(imageRef);
+    size_t height = CGImageGetHeight(imageRef);
+    size_t bitsPerComponent = 8;
+    size_t bytesPerRow = width * 4;
+
+    double matrix[9];
+    if(!AGKPOPWarpMatrixForImage(transform, anchorPoint, size, width, height, scale, matrix))
+    {
+        return NULL;
+    }
+
+    AGKPOPBufferPool *pool = AGKPOPBufferPoolShared();
+    uint8_t *inputData = AGKPOPBufferPoolAcquire(pool, height * bytesPerRow);
+    uint8_t *outputData = AGKPOPBufferPoolAcquire(pool, height * bytesPerRow);
+    if(inputData == NULL || outputData == NULL)
+    {
+        AGKPOPBufferPoolRelease(pool, inputData);
+        AGKPOPBufferPoolRelease(pool, outputData);
+        return NULL;
+    }
+
+    // Pooled buffers hold old pixels. Copying the image instead of drawing it
+    // over them replaces every pixel, so there is no need to clear first.
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    CGContextRef context = CGBitmapContextCreate(inputData, width, height, bitsPerComponent, bytesPerRow, colorSpace, kAGKPOPWarpBitmapInfo);
+    CGContextSetBlendMode(context, kCGBlendModeCopy);
+    CGContextDrawImage(context, CGRectMake(0, 0, width, height), imageRef);
+    CGContextRelease(context);
+
+    AGKPOPWarpBitmap source = {inputData, width, height, bytesPerRow};
+    AGKPOPWarpBitmap destination = {outputData, width, height, bytesPerRow};
+    AGKPOPWarp(&source, &destination, matrix, options);
+    AGKPOPBufferPoolRelease(pool, inputData);
+
+    CGImageRef newImageRef = AGKPOPWarpCreateImage(outputData, width, height, bytesPerRow, colorSpace);
+    CGColorSpaceRelease(colorSpace);
+    AGKPOPBufferPoolRelease(pool, outputData);
+
+    return newImageRef;
+}
+
+typedef struct AGKPOPWarpImageTiles {
+    CGImageRef image;
+    CGColorSpaceRef colorSpace;
+    AGKPOPWarpBitmap output;
+} AGKPOPWarpImageTiles;
+
+static bool AGKPOPWarpImageReadTile(void *context, const AGKPOPWarpBitmap *tile, size_t x, size_t y)
+{
+    AGKPOPWarpImageTiles *tiles = context;
+    size_t width = CGImageGetWidth(tiles->image);
+    size_t height = CGImageGetHeight(tiles->image);
+
+    CGContextRef ctx = CGBitmapContextCreate(tile->data, tile->width, tile->height, 8, tile->bytesPerRow, tiles->colorSpace, kAGKPOPWarpBitmapInfo);
+    if(ctx == NULL)
+    {
+        return false;
+    }
+
+    // Bitmap contexts are flipped, the first row in memory is the top of the tile
+    CGContextClearRect(ctx, CGRectMake(0, 0, tile->width, tile->height));
+    CGContextDrawImage(ctx, CGRectMake(-(CGFloat)x, (CGFloat)(y + tile->height) - (CGFloat)height, width, height), tiles->image);
+    CGContextRelease(ctx);
+    return true;
+}
+
+static bool AGKPOPWarpImageWriteTile(void *context, const AGKPOPWarpBitmap *tile, size_t x, size_t y)
+{
+    AGKPOPWarpImageTiles *tiles = context;
+    const AGKPOPWarpBitmap *output = &tiles->output;
+    for(size_t row = 0; row < tile->height; row++)
+    {
+        memcpy(output->data + (y + row) * output->bytesPerRow + x * 4, tile->data + row * tile->bytesPerRow, tile->width * 4);
+    }
+    return true;
+}
+
+CGImageRef CGImageDrawWithCATransform3DTiled_AGKPOP(CGImageRef imageRef,
+                                                    CATransform3D transform,
+                                                    CGPoint anchorPoint,
+                                                    CGSize size,
+                                                    CGFloat scale,
+                                                    const AGKPOPWarpOptions *options)
+{
+    size_t width = CGImageGetWidth(imageRef);
+    size_t height = CGImageGetHeight(imageRef);
+    size_t bytesPerRow = width * 4;
+
+    double matrix[9];
+    if(!AGKPOPWarpMatrixForImage(transform, anchorPoint, size, width, height, scale, matrix))
+    {
+        return NULL;
+    }
+
+    uint8_t *outputData = AGKPOPBufferPoolAcquire(AGKPOPBufferPoolShared(), height * bytesPerRow);
+    if(outputData == NULL)
+    {
+        return NULL;
+    }
+
+    AGKPOPWarpImageTiles tiles;
+    tiles.image = imageRef;
+    tiles.colorSpace = CGColorSpaceCreateDeviceRGB();
+    tiles.output = (AGKPOPWarpBitmap){outputData, width, height, bytesPerRow};
+
+    AGKPOPWarpTiling tiling = {0};
+    tiling.sourceWidth = width;
+    tiling.sourceHeight = height;
+    tiling.destinationWidth = width;
+    tiling.destinationHeight = height;
+    tiling.read = AGKPOPWarpImageReadTile;
+    tiling.write = AGKPOPWarpImageWriteTile;
+    tiling.context = &tiles;
+
+    CGImageRef newImageRef = NULL;
+    if(AGKPOPWarpTiled(&tiling, matrix, options))
+    {
+        newImageRef = AGKPOPWarpCreateImage(outputData, width, height, bytesPerRow, tiles.colorSpace);
+    }
+    CGColorSpaceRelease(tiles.colorSpace);
+    AGKPOPBufferPoolRelease(AGKPOPBufferPoolShared(), outputData);
+
+    return newImageRef;
+}
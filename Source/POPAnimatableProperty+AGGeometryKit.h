@@ -39,8 +39,39 @@ extern NSString * const kPOPLayerAGKQuadBottomRight;
 extern NSString * const kPOPLayerAGKQuadBottomRightX;
 extern NSString * const kPOPLayerAGKQuadBottomRightY;
 
+/**
+ * @discussion
+ *   Integer identifiers of the properties above, in the same order as
+ *   `+AGKAnimatableProperties`. Cache one to skip the name lookup.
+ */
+typedef NS_ENUM(NSInteger, AGKPOPQuadProperty) {
+    AGKPOPQuadPropertyNotFound = -1,
+    AGKPOPQuadPropertyTopLeft = 0,
+    AGKPOPQuadPropertyTopLeftX,
+    AGKPOPQuadPropertyTopLeftY,
+    AGKPOPQuadPropertyTopRight,
+    AGKPOPQuadPropertyTopRightX,
+    AGKPOPQuadPropertyTopRightY,
+    AGKPOPQuadPropertyBottomLeft,
+    AGKPOPQuadPropertyBottomLeftX,
+    AGKPOPQuadPropertyBottomLeftY,
+    AGKPOPQuadPropertyBottomRight,
+    AGKPOPQuadPropertyBottomRightX,
+    AGKPOPQuadPropertyBottomRightY,
+    AGKPOPQuadPropertyCount,
+};
+
 @interface POPAnimatableProperty (AGK_POP)
 
++ (NSArray *)AGKAnimatableProperties;
+
+/**
+ * @discussion
+ *   Names passed as the kPOPLayerAGKQuad constants are found by pointer
+ *   comparison, other strings through a dictionary built once.
+ */
 + (instancetype)AGKPropertyWithName:(NSString *)aName;
++ (AGKPOPQuadProperty)AGKPropertyIDWithName:(NSString *)aName;
++ (instancetype)AGKPropertyWithID:(AGKPOPQuadProperty)propertyID;
 
 @end
@@ -23,6 +23,7 @@
 
 #import "POPAnimatableProperty+AGGeometryKit.h"
 #import "AGGeometryKit.h"
+#import "AGKPOPQuadCoalescer.h"
 
 static CGFloat const kPOPLayerAGKQuadThreshold = 1.0;
 
@@ -42,195 +43,127 @@ NSString * const kPOPLayerAGKQuadBottomRight = @"quadrilateral.br";
 NSString * const kPOPLayerAGKQuadBottomRightX = @"quadrilateral.br.x";
 NSString * const kPOPLayerAGKQuadBottomRightY = @"quadrilateral.br.y";
 
+static NSString * const *AGKPOPQuadPropertyNames(void)
+{
+    static NSString *names[AGKPOPQuadPropertyCount];
+    static dispatch_once_t onceToken;
+
+    dispatch_once(&onceToken, ^{
+        names[AGKPOPQuadPropertyTopLeft] = kPOPLayerAGKQuadTopLeft;
+        names[AGKPOPQuadPropertyTopLeftX] = kPOPLayerAGKQuadTopLeftX;
+        names[AGKPOPQuadPropertyTopLeftY] = kPOPLayerAGKQuadTopLeftY;
+        names[AGKPOPQuadPropertyTopRight] = kPOPLayerAGKQuadTopRight;
+        names[AGKPOPQuadPropertyTopRightX] = kPOPLayerAGKQuadTopRightX;
+        names[AGKPOPQuadPropertyTopRightY] = kPOPLayerAGKQuadTopRightY;
+        names[AGKPOPQuadPropertyBottomLeft] = kPOPLayerAGKQuadBottomLeft;
+        names[AGKPOPQuadPropertyBottomLeftX] = kPOPLayerAGKQuadBottomLeftX;
+        names[AGKPOPQuadPropertyBottomLeftY] = kPOPLayerAGKQuadBottomLeftY;
+        names[AGKPOPQuadPropertyBottomRight] = kPOPLayerAGKQuadBottomRight;
+        names[AGKPOPQuadPropertyBottomRightX] = kPOPLayerAGKQuadBottomRightX;
+        names[AGKPOPQuadPropertyBottomRightY] = kPOPLayerAGKQuadBottomRightY;
+    });
+
+    return names;
+}
+
+// The twelve properties only differ in corner and axis, so they are generated
+// from these two macros instead of being written out one by one.
+
+#define AGKPOP_QUAD_CORNER_PROPERTY(corner, name) \
+    [POPAnimatableProperty propertyWithName:name initializer:^(POPMutableAnimatableProperty *prop) { \
+        prop.readBlock = ^(CALayer *layer, CGFloat values[]) { \
+            AGKQuad q = AGKPOPQuadCoalescerRead(layer); \
+            values[0] = q.corner.x; \
+            values[1] = q.corner.y; \
+        }; \
+        prop.writeBlock = ^(CALayer *layer, const CGFloat values[]) { \
+            AGKQuad q = AGKPOPQuadCoalescerRead(layer); \
+            q.corner = CGPointMake(values[0], values[1]); \
+            AGKPOPQuadCoalescerWrite(layer, q); \
+        }; \
+        prop.threshold = kPOPLayerAGKQuadThreshold; \
+    }]
+
+#define AGKPOP_QUAD_COMPONENT_PROPERTY(corner, axis, name) \
+    [POPAnimatableProperty propertyWithName:name initializer:^(POPMutableAnimatableProperty *prop) { \
+        prop.readBlock = ^(CALayer *layer, CGFloat values[]) { \
+            values[0] = AGKPOPQuadCoalescerRead(layer).corner.axis; \
+        }; \
+        prop.writeBlock = ^(CALayer *layer, const CGFloat values[]) { \
+            AGKQuad q = AGKPOPQuadCoalescerRead(layer); \
+            q.corner.axis = values[0]; \
+            AGKPOPQuadCoalescerWrite(layer, q); \
+        }; \
+        prop.threshold = kPOPLayerAGKQuadThreshold; \
+    }]
+
+// The point, x and y property of a corner, in the order of AGKPOPQuadProperty
+#define AGKPOP_QUAD_CORNER_PROPERTIES(corner, name, nameX, nameY) \
+    AGKPOP_QUAD_CORNER_PROPERTY(corner, name), \
+    AGKPOP_QUAD_COMPONENT_PROPERTY(corner, x, nameX), \
+    AGKPOP_QUAD_COMPONENT_PROPERTY(corner, y, nameY)
+
 @implementation POPAnimatableProperty (AGK)
 
 + (NSArray *)AGKAnimatableProperties
 {
     static NSArray *props;
+    static dispatch_once_t onceToken;
 
-    if(props == nil)
-    {
+    dispatch_once(&onceToken, ^{
         props =
         @[
-
-          [POPAnimatableProperty propertyWithName:kPOPLayerAGKQuadTopLeft initializer:^(POPMutableAnimatableProperty *prop) {
-              prop.readBlock = ^(CALayer *layer, CGFloat values[]) {
-                  values[0] = layer.quadrilateral.tl.x;
-                  values[1] = layer.quadrilateral.tl.y;
-              };
-              prop.writeBlock = ^(CALayer *layer, const CGFloat values[]) {
-                  AGKQuad q = layer.quadrilateral;
-                  q.tl = CGPointMake(values[0], values[1]);
-                  layer.quadrilateral = q;
-
-              };
-              prop.threshold = kPOPLayerAGKQuadThreshold;
-          }],
-
-          [POPAnimatableProperty propertyWithName:kPOPLayerAGKQuadTopLeftX initializer:^(POPMutableAnimatableProperty *prop) {
-              prop.readBlock = ^(CALayer *layer, CGFloat values[]) {
-                  values[0] = layer.quadrilateral.tl.x;
-              };
-              prop.writeBlock = ^(CALayer *layer, const CGFloat values[]) {
-                  AGKQuad q = layer.quadrilateral;
-                  q.tl.x = values[0];
-                  layer.quadrilateral = q;
-
-              };
-              prop.threshold = kPOPLayerAGKQuadThreshold;
-          }],
-
-          [POPAnimatableProperty propertyWithName:kPOPLayerAGKQuadTopLeftY initializer:^(POPMutableAnimatableProperty *prop) {
-              prop.readBlock = ^(CALayer *layer, CGFloat values[]) {
-                  values[0] = layer.quadrilateral.tl.y;
-              };
-              prop.writeBlock = ^(CALayer *layer, const CGFloat values[]) {
-                  AGKQuad q = layer.quadrilateral;
-                  q.tl.y = values[0];
-                  layer.quadrilateral = q;
-
-              };
-              prop.threshold = kPOPLayerAGKQuadThreshold;
-          }],
-
-          [POPAnimatableProperty propertyWithName:kPOPLayerAGKQuadTopRight initializer:^(POPMutableAnimatableProperty *prop) {
-              prop.readBlock = ^(CALayer *layer, CGFloat values[]) {
-                  values[0] = layer.quadrilateral.tr.x;
-                  values[1] = layer.quadrilateral.tr.y;
-              };
-              prop.writeBlock = ^(CALayer *layer, const CGFloat values[]) {
-                  AGKQuad q = layer.quadrilateral;
-                  q.tr = CGPointMake(values[0], values[1]);
-                  layer.quadrilateral = q;
-
-              };
-              prop.threshold = kPOPLayerAGKQuadThreshold;
-          }],
-
-          [POPAnimatableProperty propertyWithName:kPOPLayerAGKQuadTopRightX initializer:^(POPMutableAnimatableProperty *prop) {
-              prop.readBlock = ^(CALayer *layer, CGFloat values[]) {
-                  values[0] = layer.quadrilateral.tr.x;
-              };
-              prop.writeBlock = ^(CALayer *layer, const CGFloat values[]) {
-                  AGKQuad q = layer.quadrilateral;
-                  q.tr.x = values[0];
-                  layer.quadrilateral = q;
-
-              };
-              prop.threshold = kPOPLayerAGKQuadThreshold;
-          }],
-
-          [POPAnimatableProperty propertyWithName:kPOPLayerAGKQuadTopRightY initializer:^(POPMutableAnimatableProperty *prop) {
-              prop.readBlock = ^(CALayer *layer, CGFloat values[]) {
-                  values[0] = layer.quadrilateral.tr.y;
-              };
-              prop.writeBlock = ^(CALayer *layer, const CGFloat values[]) {
-                  AGKQuad q = layer.quadrilateral;
-                  q.tr.y = values[0];
-                  layer.quadrilateral = q;
-
-              };
-              prop.threshold = kPOPLayerAGKQuadThreshold;
-          }],
-
-          [POPAnimatableProperty propertyWithName:kPOPLayerAGKQuadBottomLeft initializer:^(POPMutableAnimatableProperty *prop) {
-              prop.readBlock = ^(CALayer *layer, CGFloat values[]) {
-                  values[0] = layer.quadrilateral.bl.x;
-                  values[1] = layer.quadrilateral.bl.y;
-              };
-              prop.writeBlock = ^(CALayer *layer, const CGFloat values[]) {
-                  AGKQuad q = layer.quadrilateral;
-                  q.bl = CGPointMake(values[0], values[1]);
-                  layer.quadrilateral = q;
-
-              };
-              prop.threshold = kPOPLayerAGKQuadThreshold;
-          }],
-
-          [POPAnimatableProperty propertyWithName:kPOPLayerAGKQuadBottomLeftX initializer:^(POPMutableAnimatableProperty *prop) {
-              prop.readBlock = ^(CALayer *layer, CGFloat values[]) {
-                  values[0] = layer.quadrilateral.bl.x;
-              };
-              prop.writeBlock = ^(CALayer *layer, const CGFloat values[]) {
-                  AGKQuad q = layer.quadrilateral;
-                  q.bl.x = values[0];
-                  layer.quadrilateral = q;
-
-              };
-              prop.threshold = kPOPLayerAGKQuadThreshold;
-          }],
-
-          [POPAnimatableProperty propertyWithName:kPOPLayerAGKQuadBottomLeftY initializer:^(POPMutableAnimatableProperty *prop) {
-              prop.readBlock = ^(CALayer *layer, CGFloat values[]) {
-                  values[0] = layer.quadrilateral.bl.y;
-              };
-              prop.writeBlock = ^(CALayer *layer, const CGFloat values[]) {
-                  AGKQuad q = layer.quadrilateral;
-                  q.bl.y = values[0];
-                  layer.quadrilateral = q;
-
-              };
-              prop.threshold = kPOPLayerAGKQuadThreshold;
-          }],
-
-          [POPAnimatableProperty propertyWithName:kPOPLayerAGKQuadBottomRight initializer:^(POPMutableAnimatableProperty *prop) {
-              prop.readBlock = ^(CALayer *layer, CGFloat values[]) {
-                  values[0] = layer.quadrilateral.br.x;
-                  values[1] = layer.quadrilateral.br.y;
-              };
-              prop.writeBlock = ^(CALayer *layer, const CGFloat values[]) {
-                  AGKQuad q = layer.quadrilateral;
-                  q.br = CGPointMake(values[0], values[1]);
-                  layer.quadrilateral = q;
-
-              };
-              prop.threshold = kPOPLayerAGKQuadThreshold;
-          }],
-
-          [POPAnimatableProperty propertyWithName:kPOPLayerAGKQuadBottomRightX initializer:^(POPMutableAnimatableProperty *prop) {
-              prop.readBlock = ^(CALayer *layer, CGFloat values[]) {
-                  values[0] = layer.quadrilateral.br.x;
-              };
-              prop.writeBlock = ^(CALayer *layer, const CGFloat values[]) {
-                  AGKQuad q = layer.quadrilateral;
-                  q.br.x = values[0];
-                  layer.quadrilateral = q;
-
-              };
-              prop.threshold = kPOPLayerAGKQuadThreshold;
-          }],
-
-          [POPAnimatableProperty propertyWithName:kPOPLayerAGKQuadBottomRightY initializer:^(POPMutableAnimatableProperty *prop) {
-              prop.readBlock = ^(CALayer *layer, CGFloat values[]) {
-                  values[0] = layer.quadrilateral.br.y;
-              };
-              prop.writeBlock = ^(CALayer *layer, const CGFloat values[]) {
-                  AGKQuad q = layer.quadrilateral;
-                  q.br.y = values[0];
-                  layer.quadrilateral = q;
-              };
-              prop.threshold = kPOPLayerAGKQuadThreshold;
-          }],
-          
+          AGKPOP_QUAD_CORNER_PROPERTIES(tl, kPOPLayerAGKQuadTopLeft, kPOPLayerAGKQuadTopLeftX, kPOPLayerAGKQuadTopLeftY),
+          AGKPOP_QUAD_CORNER_PROPERTIES(tr, kPOPLayerAGKQuadTopRight, kPOPLayerAGKQuadTopRightX, kPOPLayerAGKQuadTopRightY),
+          AGKPOP_QUAD_CORNER_PROPERTIES(bl, kPOPLayerAGKQuadBottomLeft, kPOPLayerAGKQuadBottomLeftX, kPOPLayerAGKQuadBottomLeftY),
+          AGKPOP_QUAD_CORNER_PROPERTIES(br, kPOPLayerAGKQuadBottomRight, kPOPLayerAGKQuadBottomRightX, kPOPLayerAGKQuadBottomRightY),
           ];
-    }
+    });
     
     return props;
 }
 
-+ (instancetype)AGKPropertyWithName:(NSString *)aName
++ (AGKPOPQuadProperty)AGKPropertyIDWithName:(NSString *)aName
 {
-    NSArray *props = [self AGKAnimatableProperties];
-    
-    for(POPAnimatableProperty *prop in props)
+    NSString * const *names = AGKPOPQuadPropertyNames();
+
+    for(NSInteger i = 0; i < AGKPOPQuadPropertyCount; i++)
     {
-        if([prop.name isEqualToString:aName])
+        if(names[i] == aName)
         {
-            return prop;
+            return i;
         }
     }
-    
-    return nil;
+
+    static NSDictionary *idsByName;
+    static dispatch_once_t onceToken;
+
+    dispatch_once(&onceToken, ^{
+        NSMutableDictionary *ids = [NSMutableDictionary dictionaryWithCapacity:AGKPOPQuadPropertyCount];
+        for(NSInteger i = 0; i < AGKPOPQuadPropertyCount; i++)
+        {
+            ids[names[i]] = @(i);
+        }
+        idsByName = [ids copy];
+    });
+
+    NSNumber *propertyID = aName ? idsByName[aName] : nil;
+    return propertyID ? propertyID.integerValue : AGKPOPQuadPropertyNotFound;
+}
+
++ (instancetype)AGKPropertyWithID:(AGKPOPQuadProperty)propertyID
+{
+    if(propertyID < 0 || propertyID >= AGKPOPQuadPropertyCount)
+    {
+        return nil;
+    }
+
+    return [self AGKAnimatableProperties][propertyID];
+}
+
++ (instancetype)AGKPropertyWithName:(NSString *)aName
+{
+    return [self AGKPropertyWithID:[self AGKPropertyIDWithName:aName]];
 }
 
 @end